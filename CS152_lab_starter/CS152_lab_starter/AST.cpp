@@ -8,23 +8,26 @@
 using namespace std;
 
 
+struct Stmt;   
+
+struct Expr; 
+
+
 struct VariableDeclarations {
     string name;
     optional<string> array_size;
+    bool pointer = false;   // compiler made: holds an address, indexed like an array but assignable
+    optional<vector<Expr>> initializer;     // let a[4] = {1, 2}, elements not listed are 0
 };
 
 
 struct Parameter {
     string name;    
-    bool is_array(); 
+    bool array = false;
+    bool is_array() const { return array; } 
 };  
 
 
-struct Stmt;   
-
-struct Expr; 
-
-
 struct Block {
     vector<Stmt> body;
 };
@@ -73,6 +76,10 @@ struct UnaryOperation {
 struct IntegerLiteral {
     string value;
 };
+// only ever the argument of puts, holds the bytes with the escapes already resolved
+struct StringLiteral {
+    string value;
+};
 struct VariableAccess { 
     string name; 
 };
@@ -80,10 +87,41 @@ struct ArrayAccess {
     string name;
     //string idex;
     vector<Expr> index;
+    bool in_bounds = false;     // proven by BoundsCheck, --bounds-check emits no check for it
 };
 
-struct Expr : public variant<IntegerLiteral, VariableAccess, FunctionCall, ArrayAccess, BinaryOperation, UnaryOperation> {  
-    using variant<IntegerLiteral, VariableAccess, FunctionCall, ArrayAccess, BinaryOperation, UnaryOperation>::variant;
+// a call the inliner spliced into its caller, evaluates to the callee's return value
+struct InlinedCall {
+    string name;
+    vector<Parameter> parameters;
+    vector<Expr> arguments;
+    Block body;
+};
+
+struct Expr : public variant<IntegerLiteral, VariableAccess, FunctionCall, ArrayAccess, BinaryOperation, UnaryOperation, InlinedCall, StringLiteral> {  
+    using variant<IntegerLiteral, VariableAccess, FunctionCall, ArrayAccess, BinaryOperation, UnaryOperation, InlinedCall, StringLiteral>::variant;
+    Expr() = default;
+    Expr(const Expr& other);
+    Expr(Expr&&) = default;
+    Expr& operator=(const Expr& other){ // copied aside first, other may be inside this
+        Expr copy{other};
+        return *this = std::move(copy);
+    }
+    Expr& operator=(Expr&&) = default;
+    ~Expr();
+
+    // the operands, arguments or index, null for the leaves
+    vector<Expr> *children(){
+        if(auto *call = get_if<FunctionCall>(this)) return &call->arguments;
+        if(auto *aa = get_if<ArrayAccess>(this)) return &aa->index;
+        if(auto *binop = get_if<BinaryOperation>(this)) return &binop->args;
+        if(auto *unop = get_if<UnaryOperation>(this)) return &unop->lhs;
+        if(auto *inlined = get_if<InlinedCall>(this)) return &inlined->arguments;
+        return nullptr;
+    }
+    const vector<Expr> *children() const {
+        return const_cast<Expr*>(this)->children();
+    }
 };
 
 
@@ -94,6 +132,7 @@ struct Return {
 
 struct Loop { 
     Block body;
+    bool vectorized = false;    // Codegen runs it four elements at a time before the scalar loop
 };
 
 
@@ -124,6 +163,232 @@ struct Stmt : public variant<Block, Expr, Let, Return, Loop, Break, Continue, If
 };
 
 
+// the operands that have operands of their own are moved out and taken apart on a list, so tearing
+// down an expression nested however deep doesn't recurse once for every level
+inline Expr::~Expr(){
+    vector<Expr> doomed;
+    auto take = [&](Expr& e){
+        if(auto *children = e.children()){
+            for(auto& child : *children){
+                auto *grandchildren = child.children();
+                if(grandchildren && !grandchildren->empty()){
+                    doomed.push_back(std::move(child));
+                }
+            }
+        }
+    };
+    take(*this);
+    while(!doomed.empty()){
+        Expr e = std::move(doomed.back());
+        doomed.pop_back();
+        take(e);
+    }
+}
+
+
+
+// copying doesn't recurse either. each node is copied with room left for its operands, which go on a
+// list to be copied into that room
+inline Expr::Expr(const Expr& other){
+    vector<pair<const Expr*, Expr*>> copying{{&other, this}};
+    while(!copying.empty()){
+        auto [from, to] = copying.back();
+        copying.pop_back();
+        *to = visit([](const auto& node) -> Expr {
+            using Node = decay_t<decltype(node)>;
+            if constexpr(is_same_v<Node, FunctionCall>){
+                return FunctionCall{node.name, vector<Expr>(node.arguments.size())};
+            }
+            else if constexpr(is_same_v<Node, ArrayAccess>){
+                return ArrayAccess{node.name, vector<Expr>(node.index.size()), node.in_bounds};
+            }
+            else if constexpr(is_same_v<Node, BinaryOperation>){
+                return BinaryOperation{vector<Expr>(node.args.size()), node.opcode};
+            }
+            else if constexpr(is_same_v<Node, UnaryOperation>){
+                return UnaryOperation{vector<Expr>(node.lhs.size()), node.opcode};
+            }
+            else if constexpr(is_same_v<Node, InlinedCall>){
+                return InlinedCall{node.name, node.parameters, vector<Expr>(node.arguments.size()), node.body};
+            }
+            else{
+                return node;
+            }
+        }, (const Expr::variant&)*from);
+        if(auto *operands = from->children()){
+            for(unsigned long k = 0; k < operands->size(); ++k){
+                copying.push_back({&(*operands)[k], &(*to->children())[k]});
+            }
+        }
+    }
+}
+
+// walk visits every expression children first, so visit may replace the node it is given.
+// the target of an assignment is not visited as a value, only an array target's index is.
+// an inlined call's body names the callee's variables, enter_inlined = false visits only its arguments.
+// what is left to walk is kept on a stack rather than the native one, like ~Expr, so an expression
+// nested however deep is fine. each node's children go on it last first, to come off in order
+struct Walk {
+    enum Kind { block, statement, expression, visiting } kind;
+    void *node;
+    bool enter_inlined;
+};
+
+inline void walk(Walk root, const function<void(Expr&)>& visit){
+    vector<Walk> stack{root};
+    while(!stack.empty()){
+        auto [kind, node, enter_inlined] = stack.back();
+        stack.pop_back();
+        auto push = [&](Walk::Kind kind, void *node){
+            stack.push_back({kind, node, enter_inlined});
+        };
+        auto push_all = [&](vector<Expr>& exprs){
+            for(auto e = exprs.rbegin(); e != exprs.rend(); ++e){
+                push(Walk::expression, &*e);
+            }
+        };
+
+        if(kind == Walk::visiting){
+            visit(*(Expr*)node);
+        }
+        else if(kind == Walk::block){
+            auto& body = ((Block*)node)->body;
+            for(auto s = body.rbegin(); s != body.rend(); ++s){
+                push(Walk::statement, &*s);
+            }
+        }
+        else if(kind == Walk::expression){
+            Expr& e = *(Expr*)node;
+            push(Walk::visiting, &e);
+            if(auto *call = get_if<FunctionCall>(&e)){
+                push_all(call->arguments);
+            }
+            else if(auto *aa = get_if<ArrayAccess>(&e)){
+                push_all(aa->index);
+            }
+            else if(auto *binop = get_if<BinaryOperation>(&e)){
+                push_all(binop->args);
+            }
+            else if(auto *unop = get_if<UnaryOperation>(&e)){
+                push_all(unop->lhs);
+            }
+            else if(auto *inlined = get_if<InlinedCall>(&e)){
+                if(enter_inlined){
+                    stack.push_back({Walk::block, &inlined->body, true});
+                }
+                push_all(inlined->arguments);
+            }
+        }
+        else{
+            Stmt& s = *(Stmt*)node;
+            if(auto *block = get_if<Block>(&s)){
+                push(Walk::block, block);
+            }
+            else if(auto *expr = get_if<Expr>(&s)){
+                push(Walk::expression, expr);
+            }
+            else if(auto *ret = get_if<Return>(&s)){
+                push(Walk::expression, &ret->return_value);
+            }
+            else if(auto *loop = get_if<Loop>(&s)){
+                push(Walk::block, &loop->body);
+            }
+            else if(auto *branch = get_if<If>(&s)){
+                push(Walk::block, &branch->else_body);
+                push(Walk::block, &branch->if_body);
+                push(Walk::expression, &branch->cond);
+            }
+            else if(auto *assign = get_if<Assign>(&s)){
+                push(Walk::expression, &assign->rhs);
+                if(auto *aa = get_if<ArrayAccess>(&assign->lhs)){
+                    push(Walk::expression, &aa->index[0]);
+                }
+            }
+            else if(auto *let = get_if<Let>(&s)){
+                for(auto dec = let->declarations.rbegin(); dec != let->declarations.rend(); ++dec){
+                    if(dec->initializer){
+                        push_all(*dec->initializer);
+                    }
+                }
+            }
+        }
+    }
+}
+
+inline void walk(Expr& e, const function<void(Expr&)>& visit, bool enter_inlined = true){
+    walk(Walk{Walk::expression, &e, enter_inlined}, visit);
+}
+
+inline void walk(Stmt& s, const function<void(Expr&)>& visit, bool enter_inlined = true){
+    walk(Walk{Walk::statement, &s, enter_inlined}, visit);
+}
+
+inline void walk(Block& b, const function<void(Expr&)>& visit, bool enter_inlined = true){
+    walk(Walk{Walk::block, &b, enter_inlined}, visit);
+}
+
+// the inlined calls in a statement's own expressions, not in the statements nested in it or in their
+// bodies. a pass that works on loops goes into each body itself, with the callee's names in scope
+inline void walk_inlined(Stmt& s, const function<void(InlinedCall&)>& visit){
+    auto find = [&](Expr& e){
+        walk(e, [&](Expr& e){
+            if(auto *call = get_if<InlinedCall>(&e)){
+                visit(*call);
+            }
+        }, false);
+    };
+    if(auto *expr = get_if<Expr>(&s)){
+        find(*expr);
+    }
+    else if(auto *ret = get_if<Return>(&s)){
+        find(ret->return_value);
+    }
+    else if(auto *branch = get_if<If>(&s)){
+        find(branch->cond);
+    }
+    else if(auto *assign = get_if<Assign>(&s)){
+        find(assign->lhs);
+        find(assign->rhs);
+    }
+    else if(auto *let = get_if<Let>(&s)){
+        for(auto& dec : let->declarations){
+            if(dec.initializer){
+                for(auto& e : *dec.initializer){
+                    find(e);
+                }
+            }
+        }
+    }
+}
+
+// visits every statement, parents before children (the bodies of inlined calls are not entered).
+// on a stack of its own as walk is
+inline void walk_statements(Block& b, const function<void(Stmt&)>& visit){
+    vector<Stmt*> stack;
+    auto push = [&](Block& b){
+        for(auto s = b.body.rbegin(); s != b.body.rend(); ++s){
+            stack.push_back(&*s);
+        }
+    };
+    push(b);
+    while(!stack.empty()){
+        Stmt& s = *stack.back();
+        stack.pop_back();
+        visit(s);
+        if(auto *block = get_if<Block>(&s)){
+            push(*block);
+        }
+        else if(auto *loop = get_if<Loop>(&s)){
+            push(loop->body);
+        }
+        else if(auto *branch = get_if<If>(&s)){
+            push(branch->else_body);
+            push(branch->if_body);
+        }
+    }
+}
+
+
 
 
 
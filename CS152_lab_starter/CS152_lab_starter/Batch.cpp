@@ -0,0 +1,114 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <filesystem>
+#include <map>
+
+using namespace std;
+
+
+// --batch, many sources in one process: the paths given, and those listed one per line in a
+// --manifest. each one is compiled whole on one thread, lex to codegen, and the files are spread
+// over the threads by stealing_for. every input gets its own output, input.html (or .c) next to it
+// or in --out. a file that doesn't build is named after its error and the others still are, then
+// the exit status says whether all of them were
+struct Batch {
+    using Compile = function<string(const string& source)>;
+
+    Batch(vector<string> inputs, const string& manifest, const string& out, const string& extension) : out(out), extension(extension) {
+        if(!manifest.empty()){
+            ifstream list{manifest};
+            if(!list){
+                cerr << "couldn't open " << manifest << "\n";
+                exit(EXIT_FAILURE);
+            }
+            for(string line; getline(list, line); ){
+                if(!line.empty()){
+                    inputs.push_back(line);
+                }
+            }
+        }
+
+        // two inputs written to one output would race, like a/f.src and b/f.src into the same --out.
+        // the same file listed twice is only built once
+        map<filesystem::path, string> written;     // output, the input building it
+        for(auto& input : inputs){
+            auto path = filesystem::weakly_canonical(output(input));
+            auto [it, added] = written.emplace(path, input);
+            if(added){
+                this->inputs.push_back(input);
+            }
+            else if(filesystem::weakly_canonical(it->second) != filesystem::weakly_canonical(input)){
+                cerr << it->second << " and " << input << " would both be written to " << path.string() << "\n";
+                exit(EXIT_FAILURE);
+            }
+        }
+        if(!out.empty()){
+            error_code error;
+            filesystem::create_directories(out, error);
+        }
+    }
+
+    // compiles every input on up to jobs threads, then reports the throughput on stderr. the exit
+    // status, EXIT_FAILURE if any input didn't build
+    int operator()(unsigned long jobs, const Compile& compile){
+        auto start = chrono::steady_clock::now();
+        atomic<unsigned long> bytes = 0, failed = 0;
+
+        stealing_for(inputs.size(), jobs, [&](unsigned long i){
+            throw_compile_errors = true;    // exit() here would end the process under the other threads
+            ifstream file{inputs[i], ios::binary};
+            if(!file){
+                cerr << "couldn't open " << inputs[i] << "\n";
+                ++failed;
+                return;
+            }
+            stringstream source;
+            source << file.rdbuf();
+            bytes += source.str().size();
+
+            string built;
+            try{
+                built = compile(source.str());
+            }
+            catch(CompileError&){ // what went wrong is already printed
+                cerr << "while compiling " << inputs[i] << "\n";
+                ++failed;
+                return;
+            }
+            auto path = output(inputs[i]);
+            ofstream result{path, ios::binary};
+            if(!(result << built)){
+                cerr << "couldn't write " << path.string() << "\n";
+                ++failed;
+            }
+        });
+        throw_compile_errors = false;   // stealing_for works on this thread too
+
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        double megabytes = bytes / 1e6;
+        cerr << "batch: " << inputs.size() << " files, " << megabytes << " MB in " << seconds << " s, "
+             << inputs.size() / seconds << " files/s, " << megabytes / seconds << " MB/s\n";
+        if(failed){
+            cerr << "batch: " << failed << " of " << inputs.size() << " files didn't build\n";
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    private:
+        vector<string> inputs;
+        string out, extension;
+
+        filesystem::path output(const string& input){
+            filesystem::path path{input};
+            path.replace_extension(extension);
+            return out.empty() ? path : filesystem::path{out} / path.filename();
+        }
+};
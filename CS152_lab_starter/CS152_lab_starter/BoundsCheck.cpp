@@ -0,0 +1,330 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <optional>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+
+// range analysis for --bounds-check. marks the accesses to local arrays that provably stay in bounds
+// so Codegen can leave their check out: constant indices, and a[i + d] inside a counting loop
+//     i = 0                       // or a let i outside any loop
+//     loop {
+//         if i >= 16 { break }    // i is in [0, 15] from here ...
+//         a[i] = ...
+//         i = i + 1               // ... to here, and in [1, 16] after
+//     }
+// accesses through array parameters can't be checked at all, their size isn't known
+struct BoundsCheck {
+    unsigned long checked = 0, eliminated = 0, unchecked = 0;
+    stringstream report;
+
+    BoundsCheck(Program& program){
+        for(auto& f : program.functions){
+            scopes = {{}};
+            for(auto& p : f.parameters){
+                scopes.back()[p.name] = {};
+            }
+            loop_depth = 0;
+            zeroed_lets = false;
+            analyze(f.body);
+        }
+        report << "bounds checks: " << checked << " emitted, " << eliminated << " eliminated, "
+               << unchecked << " accesses through array parameters or pointers left unchecked\n";
+    }
+
+    private:
+        struct Range {
+            long long lo, hi;
+        };
+
+        vector<unordered_map<string, optional<long long>>> scopes;     // name -> array size
+        vector<unordered_map<string, Range>> ranges;                    // facts about counters
+        unsigned long loop_depth;
+        bool zeroed_lets;   // every let starts at 0, true at function level and in inlined bodies
+
+        optional<long long> array_size(const string& name){
+            for(auto it = scopes.rbegin(); it != scopes.rend(); ++it){
+                if(it->contains(name)){
+                    return (*it)[name];
+                }
+            }
+            return {};
+        }
+
+        optional<Range> range(const string& name){
+            for(auto it = ranges.rbegin(); it != ranges.rend(); ++it){
+                if(it->contains(name)){
+                    return (*it)[name];
+                }
+            }
+            return {};
+        }
+
+        // the range of an index, if it is a constant or a counter plus a constant
+        optional<Range> range(Expr& index){
+            if(auto c = Folder::constant(index)){
+                return Range{*c, *c};
+            }
+            long long d = 0;
+            Expr *base = &index;
+            if(auto *binop = get_if<BinaryOperation>(&index); binop && binop->opcode == "+"){
+                auto c = Folder::constant(binop->args[1]);
+                if(!c){
+                    return {};
+                }
+                d = *c;
+                base = &binop->args[0];
+            }
+            auto *var = get_if<VariableAccess>(base);
+            auto r = var ? range(var->name) : nullopt;
+            if(!r){
+                return {};
+            }
+            return Range{r->lo + d, r->hi + d};
+        }
+
+        void access(ArrayAccess& aa){
+            auto size = array_size(aa.name);
+            if(!size){
+                ++unchecked;
+                return;
+            }
+            auto r = range(aa.index[0]);
+            if(r && r->lo >= 0 && r->hi < *size){
+                aa.in_bounds = true;
+                ++eliminated;
+            }
+            else{
+                ++checked;
+            }
+        }
+
+        // the accesses a statement makes itself, nested statements are visited on their own
+        void expressions(Stmt& s){
+            auto visit = [&](Expr& e){
+                if(auto *aa = get_if<ArrayAccess>(&e)){
+                    access(*aa);
+                }
+                else if(auto *inlined = get_if<InlinedCall>(&e)){
+                    analyze_inlined(*inlined);
+                }
+            };
+            if(auto *expr = get_if<Expr>(&s)){
+                walk(*expr, visit, false);
+            }
+            else if(auto *ret = get_if<Return>(&s)){
+                walk(ret->return_value, visit, false);
+            }
+            else if(auto *branch = get_if<If>(&s)){
+                walk(branch->cond, visit, false);
+            }
+            else if(auto *assign = get_if<Assign>(&s)){
+                if(holds_alternative<ArrayAccess>(assign->lhs)){
+                    walk(assign->lhs, visit, false);
+                }
+                walk(assign->rhs, visit, false);
+            }
+            else if(holds_alternative<Let>(s)){ // initializers
+                walk(s, visit, false);
+            }
+        }
+
+        void analyze_inlined(InlinedCall& call){
+            auto outer_scopes = std::move(scopes);
+            auto outer_ranges = std::move(ranges);
+            auto outer_depth = loop_depth;
+            bool outer_zeroed = zeroed_lets;
+            scopes = {{}};
+            ranges = {};
+            loop_depth = 0;
+            zeroed_lets = true;
+            for(auto& p : call.parameters){
+                scopes.back()[p.name] = {};
+            }
+            analyze(call.body);
+            scopes = std::move(outer_scopes);
+            ranges = std::move(outer_ranges);
+            loop_depth = outer_depth;
+            zeroed_lets = outer_zeroed;
+        }
+
+        void analyze(Block& b, const vector<unordered_map<string, Range>>& facts = {}){
+            scopes.push_back({});
+            for(unsigned long i = 0; i < b.body.size(); ++i){
+                Stmt& s = b.body[i];
+                if(!facts.empty()){
+                    ranges.push_back(facts[i]);
+                }
+
+                expressions(s);
+                if(auto *let = get_if<Let>(&s)){
+                    for(auto& dec : let->declarations){
+                        optional<long long> size;
+                        if(dec.array_size){
+                            size = stoll(*dec.array_size);
+                        }
+                        scopes.back()[dec.name] = size;
+                    }
+                }
+                else if(auto *block = get_if<Block>(&s)){
+                    analyze(*block);
+                }
+                else if(auto *branch = get_if<If>(&s)){
+                    analyze(branch->if_body);
+                    analyze(branch->else_body);
+                }
+                else if(auto *loop = get_if<Loop>(&s)){
+                    auto loop_facts = counters(b, i, *loop);
+                    ++loop_depth;
+                    analyze(loop->body, loop_facts);
+                    --loop_depth;
+                }
+
+                if(!facts.empty()){
+                    ranges.pop_back();
+                }
+            }
+            scopes.pop_back();
+        }
+
+        // what is known about variables in front of each statement of the loop body
+        vector<unordered_map<string, Range>> counters(Block& outer, unsigned long index, Loop& loop){
+            Block& body = loop.body;
+            vector<unordered_map<string, Range>> facts(body.body.size());
+
+            unordered_map<string, unsigned long> assignments;
+            unordered_map<string, bool> declared;
+            walk_statements(body, [&](Stmt& s){
+                if(auto *assign = get_if<Assign>(&s)){
+                    if(auto *var = get_if<VariableAccess>(&assign->lhs)){
+                        ++assignments[var->name];
+                    }
+                }
+                else if(auto *let = get_if<Let>(&s)){
+                    for(auto& dec : let->declarations){
+                        declared[dec.name] = true;
+                    }
+                }
+            });
+
+            for(unsigned long k = 0; k < body.body.size(); ++k){
+                auto *assign = get_if<Assign>(&body.body[k]);
+                auto *var = assign ? get_if<VariableAccess>(&assign->lhs) : nullptr;
+                if(!var || assignments[var->name] != 1 || declared[var->name]){
+                    continue;
+                }
+                const string& i = var->name;
+
+                // i = i + c with c > 0
+                auto *step = get_if<BinaryOperation>(&assign->rhs);
+                auto *self = step ? get_if<VariableAccess>(&step->args[0]) : nullptr;
+                auto c = step ? Folder::constant(step->args[1]) : nullopt;
+                if(!self || self->name != i || step->opcode != "+" || !c || *c <= 0){
+                    continue;
+                }
+
+                auto start = entry_value(outer, index, i);
+                if(!start || *start < 0){
+                    continue;
+                }
+
+                // a top level if i >= n { break } ahead of the step bounds i from above, as long as the
+                // step can't wrap i round past INT32_MAX to a negative that passes the guard
+                for(unsigned long g = 0; g < k; ++g){
+                    auto bound = guard(body.body[g], i, *c);
+                    if(!bound || *start > *bound || *bound - 1 + *c > INT32_MAX){
+                        continue;
+                    }
+                    for(unsigned long j = g + 1; j < body.body.size(); ++j){
+                        if(j < k){
+                            facts[j][i] = Range{*start, *bound - 1};
+                        }
+                        else if(j > k){
+                            facts[j][i] = Range{*start + *c, *bound - 1 + *c};
+                        }
+                    }
+                    break;
+                }
+            }
+            return facts;
+        }
+
+        // n when s is if i >= n { break }, if n <= i { break }, if i > n - 1 { break }, or with a step of 1, if i == n { break }
+        static optional<long long> guard(Stmt& s, const string& i, long long step){
+            auto *branch = get_if<If>(&s);
+            if(!branch || branch->if_body.body.size() != 1 || !holds_alternative<Break>(branch->if_body.body[0])){
+                return {};
+            }
+            auto *cmp = get_if<BinaryOperation>(&branch->cond);
+            if(!cmp){
+                return {};
+            }
+            auto *lhs = get_if<VariableAccess>(&cmp->args[0]);
+            auto *rhs = get_if<VariableAccess>(&cmp->args[1]);
+            auto lc = Folder::constant(cmp->args[0]), rc = Folder::constant(cmp->args[1]);
+
+            if(lhs && lhs->name == i && rc){
+                if(cmp->opcode == ">=") return *rc;
+                if(cmp->opcode == ">") return (long long)*rc + 1;
+                if(cmp->opcode == "==" && step == 1) return *rc;
+            }
+            if(rhs && rhs->name == i && lc){
+                if(cmp->opcode == "<=") return *lc;
+                if(cmp->opcode == "<") return (long long)*lc + 1;
+                if(cmp->opcode == "==" && step == 1) return *lc;
+            }
+            return {};
+        }
+
+        // the constant i holds when the loop at outer.body[index] starts, looking back through its block
+        optional<long long> entry_value(Block& outer, unsigned long index, const string& i){
+            for(unsigned long j = index; j-- > 0; ){
+                Stmt& s = outer.body[j];
+                if(auto *assign = get_if<Assign>(&s)){
+                    auto *var = get_if<VariableAccess>(&assign->lhs);
+                    if(var && var->name == i){
+                        auto c = Folder::constant(assign->rhs);
+                        return c ? optional<long long>{*c} : nullopt;
+                    }
+                    continue;
+                }
+                if(auto *let = get_if<Let>(&s)){
+                    for(auto& dec : let->declarations){
+                        if(dec.name == i){
+                            return loop_depth == 0 || zeroed_lets ? optional<long long>{0} : nullopt;
+                        }
+                    }
+                    continue;
+                }
+
+                // a nested statement that assigns i leaves its value unknown
+                bool assigned = false;
+                if(auto *block = get_if<Block>(&s)){
+                    assigned = assigns(*block, i);
+                }
+                else if(auto *loop = get_if<Loop>(&s)){
+                    assigned = assigns(loop->body, i);
+                }
+                else if(auto *branch = get_if<If>(&s)){
+                    assigned = assigns(branch->if_body, i) || assigns(branch->else_body, i);
+                }
+                if(assigned){
+                    return {};
+                }
+            }
+            return {};
+        }
+
+        static bool assigns(Block& b, const string& i){
+            bool assigned = false;
+            walk_statements(b, [&](Stmt& s){
+                auto *assign = get_if<Assign>(&s);
+                auto *var = assign ? get_if<VariableAccess>(&assign->lhs) : nullptr;
+                assigned = assigned || var && var->name == i;
+            });
+            return assigned;
+        }
+};
@@ -0,0 +1,593 @@
+#include <vector>
+#include <string>
+#include <iostream>
+#include <optional>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+
+// register bytecode for --run and --jit. every function becomes three-operand instructions over
+// numbered registers: its parameters, then one register per local for the whole call, like the wasm
+// locals they mirror, then temporaries. semantics are the generated wasm's, so wherever the bytecode
+// runs, i32 arithmetic wraps, division traps, and arrays live in a 64KiB byte-addressed memory below
+// a stack pointer each call moves by its frame size. the interpreter wants few registers and reuses
+// temporaries; the Jit allocates registers by live range and wants every temporary written only once
+struct Bytecode {
+    Bytecode(Program& program, bool bounds_check = false, bool reuse_temporaries = true)
+        : bounds_check(bounds_check), reuse_temporaries(reuse_temporaries) {
+        for(auto& f : program.functions){
+            if(function_index.contains(f.name)){
+                cerr << "Attempted redefinition of function " << f.name << "\n";
+                exit(EXIT_FAILURE);
+            }
+            function_index[f.name] = functions.size();
+            functions.push_back(Compiled{f.name, f.parameters.size()});
+        }
+        for(auto& f : program.functions){
+            compile(f);
+        }
+    }
+
+    enum class Op : uint8_t {
+        Const, Move, Add, AddImm, Sub, Mul, Div, Rem, And, Or, Xor, Shl, Shr,
+        Lt, Gt, Le, Ge, Eq, Ne, Neg, Not, Eqz,
+        Load, LoadAt, Store, StoreAt, Check, Array, Fill, Copy,
+        Jump, JumpZero, Call, Print, Putch, Puts, Return,
+    };
+
+    // registers are a, b, c. Load and Store address a base register plus an index register times 4
+    // plus imm, the At forms leave the index out. Fill zeroes imm bytes from a plus the constant b,
+    // Copy puts strings[imm] at a
+    struct Instruction {
+        Op op;
+        int32_t a = 0, b = 0, c = 0, imm = 0;
+    };
+
+    struct Compiled {
+        string name;
+        unsigned long parameters;
+        unsigned long locals = 0;       // parameters and locals, the registers zeroed on entry
+        unsigned long registers = 0;    // parameters, then every local, then temporaries
+        uint32_t frame_bytes = 0;       // stack memory for its arrays
+        vector<Instruction> code;
+    };
+
+    vector<Compiled> functions;
+    unordered_map<string, unsigned long> function_index;
+    vector<string> strings;     // what puts writes and the tables Copy puts in memory, indexed by imm
+
+    // reports a trap with the message V8 gives and stops, for whatever runs the bytecode
+    [[noreturn]] static void trap(const char *message){
+        cout.flush();
+        cerr << "trap: " << message << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    // the spellings i32.const takes: 0 to 4294967295, or down to -2147483648 for what Folder made
+    static int32_t literal(const string& value){
+        bool negative = value.starts_with("-");
+        string digits = value.substr(negative);
+        digits.erase(0, min(digits.find_first_not_of('0'), digits.size() - 1));
+        if(digits.empty() || digits.size() > 10 || stoull(digits) > (negative ? 1ull << 31 : UINT32_MAX)){
+            cerr << "integer literal " << value << " doesn't fit in 32 bits\n";
+            exit(EXIT_FAILURE);
+        }
+        uint32_t magnitude = stoull(digits);
+        return (int32_t)(negative ? 0u - magnitude : magnitude);
+    }
+
+    private:
+        struct Local {
+            int32_t reg;
+            bool is_array;
+            bool is_pointer = false;
+            optional<unsigned long> array_size;
+        };
+
+        struct ReturnTarget {       // where return goes inside an inlined body
+            int32_t result;
+            vector<size_t> jumps;
+        };
+
+        struct LoopTarget {
+            size_t start;
+            vector<size_t> breaks;
+        };
+
+        bool bounds_check, reuse_temporaries;
+        unordered_map<string, int32_t> string_index;
+
+        // per function
+        Compiled *current;
+        vector<unordered_map<string, Local>> scopes;
+        unsigned long floor;       // scopes below this are hidden from an inlined body
+        int32_t next_local, top, temporaries;
+        vector<LoopTarget> loops;
+        vector<ReturnTarget> returns;
+
+        size_t emit(Op op, int32_t a = 0, int32_t b = 0, int32_t c = 0, int32_t imm = 0){
+            current->code.push_back(Instruction{op, a, b, c, imm});
+            return current->code.size() - 1;
+        }
+
+        void patch(size_t jump){
+            current->code[jump].imm = current->code.size();
+        }
+
+        void release(int32_t to){
+            if(reuse_temporaries){
+                top = to;
+            }
+        }
+
+        int32_t temporary(){
+            int32_t t = top++;
+            current->registers = max<unsigned long>(current->registers, top);
+            return t;
+        }
+
+        Local& lookup(const string& name){
+            for(auto it = scopes.rbegin(); it != scopes.rend() - floor; ++it){
+                if(it->contains(name)){
+                    return (*it)[name];
+                }
+            }
+            cerr << "oh we looked up " << name << " but never found a symbol for it\n";
+            exit(EXIT_FAILURE);
+        }
+
+        Local& declare(const string& name, Local local){
+            if(scopes.back().contains(name)){
+                cerr << "Attempted redeclaration of " << name << "\n";
+                exit(EXIT_FAILURE);
+            }
+            return scopes.back()[name] = local;
+        }
+
+        // every local gets its own register for the whole call, like the wasm locals they mirror,
+        // so a let in a loop body keeps its value from one iteration to the next
+        static unsigned long count_locals(Block& b){
+            unsigned long n = 0;
+            walk_statements(b, [&](Stmt& s){
+                if(auto *let = get_if<Let>(&s)){
+                    n += let->declarations.size();
+                }
+            });
+            walk(b, [&](Expr& e){
+                if(auto *inlined = get_if<InlinedCall>(&e)){
+                    n += inlined->parameters.size() + count_locals(inlined->body);
+                }
+            }, false);
+            return n;
+        }
+
+        void compile(Function& f){
+            current = &functions[function_index[f.name]];
+            scopes = {{}};
+            floor = 0;
+            loops.clear();
+            returns.clear();
+
+            next_local = 0;
+            for(auto& p : f.parameters){
+                declare(p.name, Local{next_local++, p.is_array()});
+            }
+            temporaries = top = next_local + count_locals(f.body);
+            current->locals = current->registers = top;
+
+            block(f.body);
+            int32_t zero = temporary();    // falling off the end returns 0
+            emit(Op::Const, zero);
+            emit(Op::Return, zero);
+        }
+
+        void block(Block& b){
+            scopes.push_back({});
+            for(auto& s : b.body){
+                statement(s);
+                release(temporaries);
+            }
+            scopes.pop_back();
+        }
+
+        void statement(Stmt& s){
+            if(auto *expr = get_if<Expr>(&s)){
+                expression(*expr, temporary());
+            }
+            else if(auto *let = get_if<Let>(&s)){
+                for(auto& dec : let->declarations){
+                    Local& local = declare(dec.name, Local{next_local++, dec.array_size || dec.pointer, dec.pointer});
+                    if(dec.array_size){
+                        local.array_size = stoul(*dec.array_size);
+                        current->frame_bytes += 4 * *local.array_size;
+                        emit(Op::Array, local.reg, 0, 0, current->frame_bytes);
+                        if(dec.initializer){
+                            initializer(local, *dec.initializer);
+                        }
+                    }
+                    else if(!returns.empty()){ // an inlined body runs again without a fresh call zeroing its locals
+                        emit(Op::Const, local.reg);
+                    }
+                }
+            }
+            else if(auto *b = get_if<Block>(&s)){
+                block(*b);
+            }
+            else if(auto *ret = get_if<Return>(&s)){
+                if(returns.empty()){
+                    emit(Op::Return, operand(ret->return_value));
+                }
+                else{
+                    expression(ret->return_value, returns.back().result);
+                    returns.back().jumps.push_back(emit(Op::Jump));
+                }
+            }
+            else if(auto *loop = get_if<Loop>(&s)){ // a vectorized loop runs as the scalar loop it also is
+                loops.push_back(LoopTarget{current->code.size()});
+                block(loop->body);
+                emit(Op::Jump, 0, 0, 0, loops.back().start);
+                for(size_t jump : loops.back().breaks){
+                    patch(jump);
+                }
+                loops.pop_back();
+            }
+            else if(holds_alternative<Break>(s) || holds_alternative<Continue>(s)){
+                if(loops.empty()){
+                    cerr << "break or continue outside of a loop\n";
+                    exit(EXIT_FAILURE);
+                }
+                if(holds_alternative<Break>(s)){
+                    loops.back().breaks.push_back(emit(Op::Jump));
+                }
+                else{
+                    emit(Op::Jump, 0, 0, 0, loops.back().start);
+                }
+            }
+            else if(auto *branch = get_if<If>(&s)){
+                size_t skip = emit(Op::JumpZero, operand(branch->cond));
+                release(temporaries);
+                block(branch->if_body);
+                if(!branch->else_body.body.empty()){
+                    size_t end = emit(Op::Jump);
+                    patch(skip);
+                    block(branch->else_body);
+                    patch(end);
+                }
+                else{
+                    patch(skip);
+                }
+            }
+            else if(auto *assignment = get_if<Assign>(&s)){
+                if(auto *var = get_if<VariableAccess>(&assignment->lhs)){
+                    Local& local = lookup(var->name);
+                    if(local.is_array && !local.is_pointer){
+                        cerr << "Attempted assignment to array like it was a variable\n";
+                        exit(EXIT_FAILURE);
+                    }
+                    expression(assignment->rhs, local.reg);
+                }
+                else if(auto *aa = get_if<ArrayAccess>(&assignment->lhs)){
+                    Local& local = lookup(aa->name);
+                    if(!local.is_array){
+                        cerr << "Attempted assignment to variable like it was an array\n";
+                        exit(EXIT_FAILURE);
+                    }
+                    Address a = address_start(local, *aa);
+                    if(a.value){
+                        expression(*a.value, a.index);
+                    }
+                    address_end(a);
+                    int32_t value = operand(assignment->rhs);
+                    if(a.index < 0){
+                        emit(Op::StoreAt, local.reg, 0, value, a.offset);
+                    }
+                    else{
+                        emit(Op::Store, local.reg, a.index, value, a.offset);
+                    }
+                }
+                else{
+                    cerr << "Tried to assign to an expression that isn't assignable\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else{
+                cerr << "unhandled statment type\n";
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        // the register holding e, a variable's own or a temporary it was computed into
+        int32_t operand(Expr& e){
+            if(auto *var = get_if<VariableAccess>(&e)){
+                return lookup(var->name).reg;
+            }
+            int32_t t = temporary();
+            expression(e, t);
+            return t;
+        }
+
+        // the register e will be in without generating it yet: a variable's own, or a new temporary
+        // with e left in value for the caller to generate into it
+        int32_t place(Expr& e, Expr*& value){
+            if(auto *var = get_if<VariableAccess>(&e)){
+                return lookup(var->name).reg;
+            }
+            value = &e;
+            return temporary();
+        }
+
+        struct Address {
+            int32_t index = -1;         // register, -1 for none
+            Expr *value = nullptr;      // what goes in it, for the caller to generate
+            int32_t offset = 0;         // in bytes
+            uint32_t checked = 0;       // the array's size, when --bounds-check checks the index
+        };
+
+        // name[index] as an index register and a byte offset, folding constants into the offset the way
+        // Codegen does. the index is generated in between this and address_end, which checks it
+        Address address_start(Local& local, ArrayAccess& aa){
+            Expr& index = aa.index[0];
+            Address a;
+            if(bounds_check && local.array_size && !aa.in_bounds){
+                a.index = place(index, a.value);
+                a.checked = *local.array_size;
+                return a;
+            }
+
+            if(auto c = Folder::constant(index); c && *c >= 0 && *c < (1 << 28)){
+                a.offset = 4 * *c;
+                return a;
+            }
+            auto *binop = get_if<BinaryOperation>(&index);
+            if(binop && binop->opcode == "+"){
+                if(auto c = Folder::constant(binop->args[1]); c && *c >= 0 && *c < (1 << 28)){
+                    a.index = place(binop->args[0], a.value);
+                    a.offset = 4 * *c;
+                    return a;
+                }
+            }
+            a.index = place(index, a.value);
+            return a;
+        }
+
+        void address_end(Address& a){
+            if(a.checked){
+                emit(Op::Check, a.index, 0, 0, a.checked);
+            }
+        }
+
+        struct Step {
+            Expr *e;
+            int32_t dst;
+            bool finishing = false;
+            int32_t saved = 0;              // top before e, released once it has finished
+            Instruction instruction = {};   // what it finishes with, its operands in registers by now
+            Address address = {};           // an ArrayAccess's
+        };
+        vector<Step> steps;     // expression's, kept so it doesn't allocate on every call
+
+        void push(Expr *e, int32_t dst){
+            if(e){
+                steps.push_back({e, dst});
+            }
+        }
+
+        // e into dst, on a stack of its own like Codegen's gen_expression so nesting is up to memory and
+        // not the native stack. a node comes off it once to place its operands in registers and go back
+        // on, finishing, above them, then once they have been generated to emit its instruction
+        void expression(Expr& root, int32_t into){
+            unsigned long base = steps.size();  // an inlined body's expressions are generated on top
+            steps.push_back({&root, into});
+            while(steps.size() > base){
+                Step step = steps.back();
+                steps.pop_back();
+                Expr& e = *step.e;
+                int32_t dst = step.dst;
+                if(step.finishing){
+                    finish(step);
+                    release(step.saved);
+                    continue;
+                }
+
+                Step finishing{&e, dst, true, top};
+                if(auto *lit = get_if<IntegerLiteral>(&e)){
+                    emit(Op::Const, dst, 0, 0, literal(lit->value));
+                }
+                else if(auto *var = get_if<VariableAccess>(&e)){
+                    int32_t reg = lookup(var->name).reg;
+                    if(reg != dst){
+                        emit(Op::Move, dst, reg);
+                    }
+                }
+                else if(auto *call = get_if<FunctionCall>(&e)){
+                    if(call->name == "print" || call->name == "putch"){
+                        if(call->arguments.size() != 1){
+                            cerr << call->name << " takes one argument\n";
+                            exit(EXIT_FAILURE);
+                        }
+                        Expr *value = nullptr;
+                        finishing.instruction = {call->name == "print" ? Op::Print : Op::Putch, dst, place(call->arguments[0], value)};
+                        steps.push_back(finishing);
+                        push(value, finishing.instruction.b);
+                        continue;
+                    }
+                    if(call->name == "puts"){
+                        emit(Op::Puts, dst, 0, 0, constant_data(get<StringLiteral>(call->arguments[0]).value));
+                        continue;
+                    }
+                    if(!function_index.contains(call->name)){
+                        cerr << "call to undefined function " << call->name << "\n";
+                        exit(EXIT_FAILURE);
+                    }
+                    unsigned long callee = function_index[call->name];
+                    if(call->arguments.size() != functions[callee].parameters){
+                        cerr << call->name << " takes " << functions[callee].parameters << " arguments\n";
+                        exit(EXIT_FAILURE);
+                    }
+
+                    // arguments go in consecutive registers, the callee copies them into its own
+                    int32_t first = top;
+                    for(unsigned long i = 0; i < call->arguments.size(); ++i){
+                        temporary();
+                    }
+                    finishing.instruction = {Op::Call, dst, (int32_t)callee, first};
+                    steps.push_back(finishing);
+                    for(unsigned long i = call->arguments.size(); i-- > 0;){
+                        push(&call->arguments[i], first + i);
+                    }
+                }
+                else if(auto *call = get_if<InlinedCall>(&e)){
+                    int32_t first = next_local;     // arguments are evaluated in the caller's scope
+                    next_local += call->parameters.size();
+                    finishing.instruction.c = first;    // where finish finds the arguments
+                    steps.push_back(finishing);
+                    for(unsigned long i = call->arguments.size(); i-- > 0;){
+                        push(&call->arguments[i], first + i);
+                    }
+                }
+                else if(auto *aa = get_if<ArrayAccess>(&e)){
+                    Local& local = lookup(aa->name);
+                    if(!local.is_array){
+                        cerr << "Old C stuff, denied :(\n";
+                        exit(EXIT_FAILURE);
+                    }
+                    finishing.address = address_start(local, *aa);
+                    finishing.instruction = {Op::LoadAt, dst, local.reg, 0, finishing.address.offset};
+                    if(finishing.address.index >= 0){
+                        finishing.instruction = {Op::Load, dst, local.reg, finishing.address.index, finishing.address.offset};
+                    }
+                    steps.push_back(finishing);
+                    push(finishing.address.value, finishing.address.index);
+                }
+                else if(auto *unop = get_if<UnaryOperation>(&e)){
+                    static const unordered_map<string, Op> ops{{"-", Op::Neg}, {"~", Op::Not}, {"!", Op::Eqz}};
+                    if(unop->opcode == "+"){
+                        push(&unop->lhs[0], dst);
+                    }
+                    else if(ops.contains(unop->opcode)){
+                        Expr *value = nullptr;
+                        finishing.instruction = {ops.at(unop->opcode), dst, place(unop->lhs[0], value)};
+                        steps.push_back(finishing);
+                        push(value, finishing.instruction.b);
+                    }
+                    else{
+                        cerr << "UnaryOp unimplemented\n";
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else if(auto *binop = get_if<BinaryOperation>(&e)){
+                    static const unordered_map<string, Op> ops{
+                        {"+", Op::Add}, {"-", Op::Sub}, {"*", Op::Mul}, {"/", Op::Div}, {"%", Op::Rem},
+                        {"&", Op::And}, {"|", Op::Or}, {"^", Op::Xor}, {"<<", Op::Shl}, {">>", Op::Shr},
+                        {"<", Op::Lt}, {">", Op::Gt}, {"<=", Op::Le}, {">=", Op::Ge}, {"==", Op::Eq}, {"!=", Op::Ne},
+                    };
+                    if(!ops.contains(binop->opcode)){
+                        cerr << "BinaryOp unimplemente\n";
+                        exit(EXIT_FAILURE);
+                    }
+                    Expr *lhs = nullptr, *rhs = nullptr;
+                    auto c = Folder::constant(binop->args[1]);
+                    if(c && (binop->opcode == "+" || binop->opcode == "-" && *c != INT32_MIN)){ // i = i + 1 in one instruction
+                        finishing.instruction = {Op::AddImm, dst, place(binop->args[0], lhs), 0, binop->opcode == "+" ? *c : -*c};
+                    }
+                    else{
+                        int32_t a = place(binop->args[0], lhs);
+                        finishing.instruction = {ops.at(binop->opcode), dst, a, place(binop->args[1], rhs)};
+                    }
+                    steps.push_back(finishing);
+                    push(rhs, finishing.instruction.c);
+                    push(lhs, finishing.instruction.b);
+                }
+                else{
+                    cerr << "unhandled expression type\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+
+        // once its operands are in registers
+        void finish(Step& step){
+            if(auto *call = get_if<InlinedCall>(step.e)){
+                inlined_body(*call, step.dst, step.instruction.c);
+                return;
+            }
+            if(holds_alternative<ArrayAccess>(*step.e)){
+                address_end(step.address);
+            }
+            Instruction& i = step.instruction;
+            emit(i.op, i.a, i.b, i.c, i.imm);
+        }
+
+        int32_t constant_data(const string& bytes){
+            if(!string_index.contains(bytes)){
+                string_index[bytes] = strings.size();
+                strings.push_back(bytes);
+            }
+            return string_index[bytes];
+        }
+
+        // like Codegen: a table of constants is copied in, other elements stored one by one, the rest zeroed
+        void initializer(Local& array, vector<Expr>& elements){
+            string table;
+            bool constant = true;
+            for(auto& e : elements){
+                auto value = Folder::value(e);
+                constant = constant && value;
+                for(int i = 0; value && i < 4; ++i){
+                    table += (char)((uint32_t)*value >> 8 * i);
+                }
+            }
+
+            uint32_t initialized = 0;
+            if(constant){
+                while(table.ends_with(string(4, '\0'))){
+                    table.resize(table.size() - 4);
+                }
+                if(!table.empty()){
+                    emit(Op::Copy, array.reg, 0, 0, constant_data(table));
+                }
+                initialized = table.size();
+            }
+            else{
+                for(unsigned long i = 0; i < elements.size(); ++i){
+                    int32_t saved = top;
+                    emit(Op::StoreAt, array.reg, 0, operand(elements[i]), 4 * i);
+                    release(saved);
+                }
+                initialized = 4 * elements.size();
+            }
+            if(initialized < 4 * *array.array_size){
+                emit(Op::Fill, array.reg, initialized, 0, 4 * *array.array_size - initialized);
+            }
+        }
+
+        // the arguments are in the parameters' registers from first on
+        void inlined_body(InlinedCall& call, int32_t dst, int32_t first){
+            unsigned long outer_floor = floor;
+            scopes.push_back({});
+            floor = scopes.size() - 1;
+            for(unsigned long i = 0; i < call.parameters.size(); ++i){
+                declare(call.parameters[i].name, Local{first + (int32_t)i, call.parameters[i].is_array()});
+            }
+
+            auto outer_loops = std::move(loops);
+            loops = {};
+            auto outer_temporaries = temporaries;
+            temporaries = top;
+            returns.push_back(ReturnTarget{dst});
+            block(call.body);
+            emit(Op::Const, dst);
+            for(size_t jump : returns.back().jumps){
+                patch(jump);
+            }
+            returns.pop_back();
+            temporaries = outer_temporaries;
+            loops = std::move(outer_loops);
+
+            scopes.pop_back();
+            floor = outer_floor;
+        }
+};
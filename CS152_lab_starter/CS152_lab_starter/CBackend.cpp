@@ -0,0 +1,672 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+using namespace std;
+
+
+// the C every translation starts with: i32 operations with the exact semantics of the wasm ones,
+// written so they don't lean on anything C99 leaves implementation defined
+static const char *C_RUNTIME = R"(#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t memory[65536];
+static uint32_t stack_ptr;
+
+static void trap(const char *message){
+    fflush(stdout);
+    fprintf(stderr, "trap: %s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+/* two's complement wrap of the low 32 bits, a plain cast is implementation defined */
+static int32_t i32(uint32_t u){
+    return u <= INT32_MAX ? (int32_t)u : (int32_t)(u - 2147483648u) - INT32_MAX - 1;
+}
+
+static int32_t i32_add(int32_t a, int32_t b){ return i32((uint32_t)a + (uint32_t)b); }
+static int32_t i32_sub(int32_t a, int32_t b){ return i32((uint32_t)a - (uint32_t)b); }
+static int32_t i32_mul(int32_t a, int32_t b){ return i32((uint32_t)a * (uint32_t)b); }
+static int32_t i32_and(int32_t a, int32_t b){ return a & b; }
+static int32_t i32_or(int32_t a, int32_t b){ return a | b; }
+static int32_t i32_xor(int32_t a, int32_t b){ return a ^ b; }
+static int32_t i32_shl(int32_t a, int32_t b){ return i32((uint32_t)a << (b & 31)); }
+static int32_t i32_shr_s(int32_t a, int32_t b){ return a < 0 ? ~(~a >> (b & 31)) : a >> (b & 31); }
+static int32_t i32_neg(int32_t a){ return i32(0u - (uint32_t)a); }
+
+static int32_t i32_div_s(int32_t a, int32_t b){
+    if(b == 0) trap("divide by zero");
+    if(a == INT32_MIN && b == -1) trap("divide result unrepresentable");
+    return a / b;
+}
+
+static int32_t i32_rem_s(int32_t a, int32_t b){
+    if(b == 0) trap("divide by zero");
+    return b == -1 ? 0 : a % b;
+}
+
+/* address + offset doesn't wrap in wasm, it is 33 bits wide */
+static uint8_t *address(int32_t base, uint32_t offset){
+    uint64_t at = (uint64_t)(uint32_t)base + offset;
+    if(at + 4 > sizeof(memory)) trap("memory access out of bounds");
+    return memory + at;
+}
+
+static int32_t load(int32_t base, uint32_t offset){
+    uint8_t *p = address(base, offset);
+    return i32((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+}
+
+static void store(int32_t base, uint32_t offset, int32_t value){
+    uint8_t *p = address(base, offset);
+    uint32_t v = (uint32_t)value;
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+/* memory.fill with zero and memory.copy, both trap before writing anything */
+static void fill(int32_t base, uint32_t bytes){
+    if((uint64_t)(uint32_t)base + bytes > sizeof(memory)) trap("memory access out of bounds");
+    memset(memory + (uint32_t)base, 0, bytes);
+}
+
+static void copy(int32_t base, const unsigned char *table, uint32_t bytes){
+    if((uint64_t)(uint32_t)base + bytes > sizeof(memory)) trap("memory access out of bounds");
+    memcpy(memory + (uint32_t)base, table, bytes);
+}
+
+static int32_t print(int32_t value){
+    printf("%ld\n", (long)value);
+    return 0;
+}
+
+static int32_t putch(int32_t value){
+    putchar((unsigned char)value);
+    return 0;
+}
+
+static int32_t puts_string(const unsigned char *text, size_t length){
+    fwrite(text, 1, length, stdout);
+    return 0;
+}
+)";
+
+
+// translates a Program to C99 for --emit-c, to be built by any C compiler, clang -O3 out.c say.
+// expressions are flattened into one temporary per operation, which fixes the left to right order
+// wasm evaluates in where C would leave it unspecified, and lets an inlined call's body, statements
+// and all, sit in the middle of one. arrays live in a 64KiB memory below a stack pointer each call
+// moves by its frame size, so addresses and --bounds-check traps come out the same as in the wasm
+struct CBackend {
+    stringstream c;
+
+    CBackend(Program& program, bool bounds_check = false) : bounds_check(bounds_check) {
+        c << C_RUNTIME;
+        for(auto& f : program.functions){
+            if(functions.contains(f.name)){
+                cerr << "Attempted redefinition of function " << f.name << "\n";
+                compile_error();
+            }
+            functions[f.name] = Callee{"f" + to_string(functions.size()) + "_" + identifier(f.name), f.parameters.size()};
+        }
+        for(auto& f : program.functions){
+            gen_function(f);
+        }
+        c << "\n";
+        c << data.str();    // the strings and tables the functions use
+        for(auto& f : program.functions){
+            c << "static int32_t " << signature(f) << ";\n";
+        }
+        c << definitions.str();
+        if(!functions.contains("main")){
+            cerr << "no main function to call\n";
+            compile_error();
+        }
+        c << "\nint main(void){\n";
+        c << "    " << functions["main"].name << "(";
+        for(unsigned long i = 0; i < functions["main"].parameters; ++i){ // as the page calls it, undefined is 0
+            c << (i ? ", 0" : "0");
+        }
+        c << ");\n";
+        c << "    return 0;\n";
+        c << "}\n";
+    }
+
+    private:
+        struct Callee {
+            string name;
+            unsigned long parameters;
+        };
+
+        struct Symbol {
+            string name;
+            bool is_array;
+            bool is_pointer = false;
+            optional<unsigned long> array_size;
+        };
+
+        struct ReturnTarget {   // the function's own epilogue, or the end of an inlined body
+            string result, label;
+        };
+
+        unordered_map<string, Callee> functions;
+        stringstream data, definitions;
+        unordered_map<string, string> segments;     // read only bytes, a string or a table -> the array holding them
+        bool bounds_check;
+
+        // per function
+        stringstream decl, inst;
+        vector<unordered_map<string, Symbol>> scopes;
+        unsigned long floor;    // scopes below this are hidden from an inlined body
+        unsigned long counter, stack_counter, loop_depth, indent;
+        vector<ReturnTarget> returns;
+
+        // source names may be C keywords, or carry the dots Specializer puts in
+        static string identifier(const string& name){
+            string id;
+            for(char ch : name){
+                id += isalnum((unsigned char)ch) ? ch : '_';
+            }
+            return id;
+        }
+
+        // a string literal, with octal escapes that are always three digits so they can't run into the
+        // character after them. C99 only promises literals up to 4095 characters, longer ones are listed out
+        static string initializer(const string& text){
+            string s;
+            if(text.size() > 4095){
+                for(unsigned char ch : text){
+                    s += (s.empty() ? "{" : ", ") + to_string(ch);
+                }
+                return s + "}";
+            }
+            s = "\"";
+            for(unsigned char ch : text){
+                if(ch >= ' ' && ch < 127 && ch != '"' && ch != '\\' && ch != '?'){
+                    s += ch;
+                }
+                else{
+                    s += {'\\', char('0' + (ch >> 6)), char('0' + (ch >> 3 & 7)), char('0' + (ch & 7))};
+                }
+            }
+            return s + "\"";
+        }
+
+        string constant_data(const string& bytes){
+            if(!segments.contains(bytes)){
+                segments[bytes] = "data" + to_string(segments.size());
+                data << "static const unsigned char " << segments[bytes] << "[] = " << initializer(bytes) << ";\n";
+            }
+            return segments[bytes];
+        }
+
+        string signature(Function& f){
+            string s = functions[f.name].name + "(";
+            for(unsigned long i = 0; i < f.parameters.size(); ++i){
+                s += (i ? ", int32_t p" : "int32_t p") + to_string(i);
+            }
+            return s + (f.parameters.empty() ? "void)" : ")");
+        }
+
+        ostream& line(){
+            return inst << string(4 * indent, ' ');
+        }
+
+        string temporary(){
+            string t = "t" + to_string(counter++);
+            decl << "    int32_t " << t << " = 0;\n";
+            return t;
+        }
+
+        Symbol& lookup(const string& name){
+            for(auto it = scopes.rbegin(); it != scopes.rend() - floor; ++it){
+                if(it->contains(name)){
+                    return (*it)[name];
+                }
+            }
+            cerr << "oh we looked up " << name << " but never found a symbol for it\n";
+            compile_error();
+        }
+
+        Symbol& declare(const string& name, Symbol s){
+            if(scopes.back().contains(name)){
+                cerr << "Attempted redeclaration of " << name << "\n";
+                compile_error();
+            }
+            return scopes.back()[name] = s;
+        }
+
+        // a fresh zeroed C local for a source variable, wasm locals start at 0 too
+        string local(const string& name){
+            string id = "v" + to_string(counter++) + "_" + identifier(name);
+            decl << "    int32_t " << id << " = 0;\n";
+            return id;
+        }
+
+        void gen_function(Function& f){
+            decl = {};
+            inst = {};
+            scopes = {{}};
+            floor = counter = stack_counter = loop_depth = 0;
+            indent = 1;
+            returns.clear();
+
+            for(unsigned long i = 0; i < f.parameters.size(); ++i){
+                declare(f.parameters[i].name, Symbol{"p" + to_string(i), f.parameters[i].is_array()});
+            }
+            string result = temporary();
+            returns.push_back(ReturnTarget{result, "epilogue"});
+            gen_block(f.body);
+            line() << "goto epilogue;\n";
+
+            definitions << "\nstatic int32_t " << signature(f) << "{\n";
+            definitions << decl.str();
+            definitions << "    stack_ptr += " << 4 * stack_counter << "u;\n";
+            definitions << inst.str();
+            definitions << "epilogue:\n";
+            definitions << "    stack_ptr -= " << 4 * stack_counter << "u;\n";
+            definitions << "    return " << result << ";\n";
+            definitions << "}\n";
+        }
+
+        void gen_block(Block& b){
+            scopes.push_back({});
+            for(auto& s : b.body){
+                gen_statement(s);
+            }
+            scopes.pop_back();
+        }
+
+        void gen_statement(Stmt& s){
+            if(auto *expr = get_if<Expr>(&s)){
+                gen_expression(*expr);
+            }
+            else if(auto *let = get_if<Let>(&s)){
+                for(auto& dec : let->declarations){
+                    Symbol& sym = declare(dec.name, Symbol{local(dec.name), dec.array_size || dec.pointer, dec.pointer});
+                    if(dec.array_size){
+                        sym.array_size = stoul(*dec.array_size);
+                        stack_counter += *sym.array_size;
+                        line() << sym.name << " = i32(stack_ptr - " << 4 * stack_counter << "u);\n";
+                        if(dec.initializer){
+                            gen_initializer(sym, *dec.initializer);
+                        }
+                    }
+                    else if(returns.size() > 1){ // an inlined body runs again without a fresh call zeroing its locals
+                        line() << sym.name << " = 0;\n";
+                    }
+                }
+            }
+            else if(auto *block = get_if<Block>(&s)){
+                line() << "{\n";
+                ++indent;
+                gen_block(*block);
+                --indent;
+                line() << "}\n";
+            }
+            else if(auto *ret = get_if<Return>(&s)){
+                string value = gen_expression(ret->return_value);
+                line() << returns.back().result << " = " << value << ";\n";
+                line() << "goto " << returns.back().label << ";\n";
+            }
+            else if(auto *loop = get_if<Loop>(&s)){
+                line() << "for(;;){\n";
+                ++indent;
+                ++loop_depth;
+                gen_block(loop->body);
+                --loop_depth;
+                --indent;
+                line() << "}\n";
+            }
+            else if(holds_alternative<Break>(s) || holds_alternative<Continue>(s)){
+                if(!loop_depth){
+                    cerr << "break or continue outside of a loop\n";
+                    compile_error();
+                }
+                line() << (holds_alternative<Break>(s) ? "break;\n" : "continue;\n");
+            }
+            else if(auto *branch = get_if<If>(&s)){
+                string cond = gen_expression(branch->cond);
+                line() << "if(" << cond << " != 0){\n";
+                ++indent;
+                gen_block(branch->if_body);
+                --indent;
+                if(!branch->else_body.body.empty()){
+                    line() << "}\n";
+                    line() << "else{\n";
+                    ++indent;
+                    gen_block(branch->else_body);
+                    --indent;
+                }
+                line() << "}\n";
+            }
+            else if(auto *assignment = get_if<Assign>(&s)){
+                if(auto *var = get_if<VariableAccess>(&assignment->lhs)){
+                    Symbol& sym = lookup(var->name);
+                    if(sym.is_array && !sym.is_pointer){
+                        cerr << "Attempted assignment to array like it was a variable\n";
+                        compile_error();
+                    }
+                    string value = gen_expression(assignment->rhs);
+                    line() << sym.name << " = " << value << ";\n";
+                }
+                else if(auto *aa = get_if<ArrayAccess>(&assignment->lhs)){
+                    Symbol& sym = lookup(aa->name);
+                    if(!sym.is_array){
+                        cerr << "Attempted assignment to variable like it was an array\n";
+                        compile_error();
+                    }
+                    auto [base, offset] = gen_address(sym, *aa);
+                    string value = gen_expression(assignment->rhs);
+                    line() << "store(" << base << ", " << offset << "u, " << value << ");\n";
+                }
+                else{
+                    cerr << "Tried to assign to an expression that isn't assignable\n";
+                    compile_error();
+                }
+            }
+            else{
+                cerr << "unhandled statment type\n";
+                compile_error();
+            }
+        }
+
+        // like Codegen: a table of constants is copied in, other elements stored one by one, the rest zeroed
+        void gen_initializer(Symbol& sym, vector<Expr>& elements){
+            string table;
+            bool constant = true;
+            for(auto& e : elements){
+                auto value = Folder::value(e);
+                constant = constant && value;
+                for(int i = 0; value && i < 4; ++i){
+                    table += (char)((uint32_t)*value >> 8 * i);
+                }
+            }
+
+            unsigned long initialized = 0;
+            if(constant){
+                while(table.ends_with(string(4, '\0'))){
+                    table.resize(table.size() - 4);
+                }
+                if(!table.empty()){
+                    line() << "copy(" << sym.name << ", " << constant_data(table) << ", " << table.size() << "u);\n";
+                }
+                initialized = table.size();
+            }
+            else{
+                for(unsigned long i = 0; i < elements.size(); ++i){
+                    string value = gen_expression(elements[i]);
+                    line() << "store(" << sym.name << ", " << 4 * i << "u, " << value << ");\n";
+                }
+                initialized = 4 * elements.size();
+            }
+            if(initialized < 4 * *sym.array_size){
+                line() << "fill(i32_add(" << sym.name << ", " << initialized << "), " << 4 * *sym.array_size - initialized << "u);\n";
+            }
+        }
+
+        struct Address {
+            string base;                // the temporary it goes in
+            unsigned long offset = 0;
+            Expr *index = nullptr;      // what's left of the index, generated in between
+            bool checked = false;       // with --bounds-check, against the array's size
+        };
+
+        // the base address of name[index] and a constant byte offset folded out of the index, the way
+        // Codegen does. the index is generated between address_start and address_end
+        Address address_start(Symbol& sym, ArrayAccess& aa){
+            Expr& index = aa.index[0];
+            Address a{temporary()};
+            if(bounds_check && sym.array_size && !aa.in_bounds){
+                a.index = &index;
+                a.checked = true;
+                return a;
+            }
+
+            if(auto c = Folder::constant(index); c && *c >= 0 && *c < (1 << 28)){
+                line() << a.base << " = " << sym.name << ";\n";
+                a.offset = 4 * *c;
+                return a;
+            }
+            a.index = &index;
+            auto *binop = get_if<BinaryOperation>(&index);
+            if(binop && binop->opcode == "+"){
+                if(auto c = Folder::constant(binop->args[1]); c && *c >= 0 && *c < (1 << 28)){
+                    a.index = &binop->args[0];
+                    a.offset = 4 * *c;
+                }
+            }
+            return a;
+        }
+
+        void address_end(Symbol& sym, Address& a, const string& i){
+            if(a.checked){
+                line() << "if((uint32_t)" << i << " >= " << *sym.array_size << "u) trap(\"unreachable\");\n";
+            }
+            line() << a.base << " = i32_add(" << sym.name << ", i32_mul(" << i << ", 4));\n";
+        }
+
+        pair<string, unsigned long> gen_address(Symbol& sym, ArrayAccess& aa){
+            Address a = address_start(sym, aa);
+            if(a.index){
+                address_end(sym, a, gen_expression(*a.index));
+            }
+            return {a.base, a.offset};
+        }
+
+        struct Step {
+            Expr *e;
+            bool finishing = false;
+            unsigned long parameter = 0;    // an InlinedCall's to bind its argument to, past the last for its body
+            Address address = {};           // an ArrayAccess's
+        };
+        vector<Step> steps;         // gen_expression's, like Codegen's
+        vector<string> values;      // what the operands generated so far came to
+
+        // e finishes once operands, the first on top, have been generated
+        void push_operands(Expr& e, vector<Expr>& operands){
+            steps.push_back({&e, true});
+            for(auto it = operands.rbegin(); it != operands.rend(); ++it){
+                steps.push_back({&*it});
+            }
+        }
+
+        string pop_value(){
+            string value = std::move(values.back());
+            values.pop_back();
+            return value;
+        }
+
+        // C for the value of e: a literal, a variable, or a temporary it was computed into. post-order
+        // on a stack of its own like Codegen's gen_expression, so nesting is up to memory and not the
+        // native stack
+        string gen_expression(Expr& root){
+            unsigned long base = steps.size();  // an inlined body's expressions are generated on top
+            steps.push_back({&root});
+            while(steps.size() > base){
+                Step step = steps.back();
+                steps.pop_back();
+                Expr& e = *step.e;
+                if(step.finishing){
+                    values.push_back(gen_operation(step));
+                }
+                else if(auto *lit = get_if<IntegerLiteral>(&e)){
+                    int32_t value = Bytecode::literal(lit->value);
+                    values.push_back(value == INT32_MIN ? "(-2147483647 - 1)" : to_string(value));
+                }
+                else if(auto *var = get_if<VariableAccess>(&e)){
+                    values.push_back(lookup(var->name).name);
+                }
+                else if(auto *call = get_if<FunctionCall>(&e)){
+                    if(call->name == "puts"){
+                        auto& text = get<StringLiteral>(call->arguments[0]).value;
+                        string t = temporary();
+                        line() << t << " = puts_string(" << constant_data(text) << ", " << text.size() << ");\n";
+                        values.push_back(t);
+                        continue;
+                    }
+                    if(call->name == "print" || call->name == "putch"){
+                        if(call->arguments.size() != 1){
+                            cerr << call->name << " takes one argument\n";
+                            compile_error();
+                        }
+                    }
+                    else if(!functions.contains(call->name)){
+                        cerr << "call to undefined function " << call->name << "\n";
+                        compile_error();
+                    }
+                    else if(call->arguments.size() != functions[call->name].parameters){
+                        cerr << call->name << " takes " << functions[call->name].parameters << " arguments\n";
+                        compile_error();
+                    }
+                    push_operands(e, call->arguments);
+                }
+                else if(auto *call = get_if<InlinedCall>(&e)){ // each argument is bound before the next is generated
+                    steps.push_back({&e, true, call->parameters.size()});
+                    for(unsigned long i = call->parameters.size(); i-- > 0;){
+                        steps.push_back({&e, true, i});
+                        steps.push_back({&call->arguments[i]});
+                    }
+                }
+                else if(auto *aa = get_if<ArrayAccess>(&e)){
+                    Symbol& sym = lookup(aa->name);
+                    if(!sym.is_array){
+                        cerr << "Old C stuff, denied :(\n";
+                        compile_error();
+                    }
+                    Address a = address_start(sym, *aa);
+                    steps.push_back({&e, true, 0, a});
+                    if(a.index){
+                        steps.push_back({a.index});
+                    }
+                }
+                else if(auto *unop = get_if<UnaryOperation>(&e)){
+                    push_operands(e, unop->lhs);
+                }
+                else if(auto *binop = get_if<BinaryOperation>(&e)){
+                    push_operands(e, binop->args);
+                }
+                else{
+                    cerr << "unhandled expression type\n";
+                    compile_error();
+                }
+            }
+            return pop_value();
+        }
+
+        // what a node comes to once its operands' values are on values, the last on top
+        string gen_operation(Step& step){
+            Expr& e = *step.e;
+            if(auto *call = get_if<FunctionCall>(&e)){
+                string name = call->name == "print" || call->name == "putch" ? call->name : functions[call->name].name;
+                vector<string> arguments(call->arguments.size());
+                for(auto it = arguments.rbegin(); it != arguments.rend(); ++it){
+                    *it = pop_value();
+                }
+                string t = temporary();
+                line() << t << " = " << name << "(";
+                for(unsigned long i = 0; i < arguments.size(); ++i){
+                    inst << (i ? ", " : "") << arguments[i];
+                }
+                inst << ");\n";
+                return t;
+            }
+            if(auto *call = get_if<InlinedCall>(&e)){
+                if(step.parameter < call->parameters.size()){ // in the caller's scope
+                    string value = pop_value();
+                    string parameter = local(call->parameters[step.parameter].name);
+                    line() << parameter << " = " << value << ";\n";
+                    return parameter;
+                }
+                vector<string> parameters(call->parameters.size());
+                for(auto it = parameters.rbegin(); it != parameters.rend(); ++it){
+                    *it = pop_value();
+                }
+                return gen_inlined(*call, parameters);
+            }
+            if(auto *aa = get_if<ArrayAccess>(&e)){
+                Symbol& sym = lookup(aa->name);
+                if(step.address.index){
+                    address_end(sym, step.address, pop_value());
+                }
+                string t = temporary();
+                line() << t << " = load(" << step.address.base << ", " << step.address.offset << "u);\n";
+                return t;
+            }
+            if(auto *unop = get_if<UnaryOperation>(&e)){
+                string operand = pop_value();
+                if(unop->opcode == "+"){
+                    return operand;
+                }
+                string t = temporary();
+                if(unop->opcode == "-"){
+                    line() << t << " = i32_neg(" << operand << ");\n";
+                }
+                else if(unop->opcode == "~"){
+                    line() << t << " = ~" << operand << ";\n";
+                }
+                else if(unop->opcode == "!"){
+                    line() << t << " = " << operand << " == 0;\n";
+                }
+                else{
+                    cerr << "UnaryOp unimplemented\n";
+                    compile_error();
+                }
+                return t;
+            }
+            auto& binop = get<BinaryOperation>(e);
+            static const unordered_map<string, string> helpers{
+                {"+", "i32_add"}, {"-", "i32_sub"}, {"*", "i32_mul"}, {"/", "i32_div_s"}, {"%", "i32_rem_s"},
+                {"&", "i32_and"}, {"|", "i32_or"}, {"^", "i32_xor"}, {"<<", "i32_shl"}, {">>", "i32_shr_s"},
+            };
+            static const unordered_set<string> relational{"<", ">", "<=", ">=", "==", "!="};
+            string rhs = pop_value();
+            string lhs = pop_value();
+            string t = temporary();
+            if(helpers.contains(binop.opcode)){
+                line() << t << " = " << helpers.at(binop.opcode) << "(" << lhs << ", " << rhs << ");\n";
+            }
+            else if(relational.contains(binop.opcode)){
+                line() << t << " = " << lhs << " " << binop.opcode << " " << rhs << ";\n";
+            }
+            else{
+                cerr << "BinaryOp unimplemente\n";
+                compile_error();
+            }
+            return t;
+        }
+
+        // the body, once the arguments are in the parameters
+        string gen_inlined(InlinedCall& call, vector<string>& parameters){
+            unsigned long outer_floor = floor, outer_depth = loop_depth;
+            scopes.push_back({});
+            floor = scopes.size() - 1;
+            loop_depth = 0;
+            for(unsigned long i = 0; i < call.parameters.size(); ++i){
+                declare(call.parameters[i].name, Symbol{parameters[i], call.parameters[i].is_array()});
+            }
+
+            string result = temporary();
+            string label = "inline_" + identifier(call.name) + to_string(counter++);
+            returns.push_back(ReturnTarget{result, label});
+            line() << "{\n";
+            ++indent;
+            gen_block(call.body);
+            line() << result << " = 0;\n";
+            --indent;
+            line() << "}\n";
+            inst << label << ":;\n";
+            returns.pop_back();
+
+            scopes.pop_back();
+            floor = outer_floor;
+            loop_depth = outer_depth;
+            return result;
+        }
+};
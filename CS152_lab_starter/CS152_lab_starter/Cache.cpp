@@ -0,0 +1,182 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <optional>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <cstdint>
+#include <filesystem>
+
+using namespace std;
+
+
+// entries written by another build of the compiler don't match, the code it generates may differ.
+// bump the version with any change to what is generated. the build scripts also pass a hash of the
+// sources as COMPILER_SOURCES, so even a change that forgot to doesn't hand back old entries. both
+// are the same for the same sources, unlike the time of the build, so rebuilding keeps the caches
+#ifndef COMPILER_SOURCES
+#define COMPILER_SOURCES "unhashed"
+#endif
+static const string COMPILER_BUILD = "v1 " COMPILER_SOURCES;
+
+
+// SHA-256, the cache keys. a collision would silently hand back some other code, so no cheap hash
+struct Sha256 {
+    Sha256& operator<<(string_view bytes){
+        for(unsigned char ch : bytes){
+            block[filled++] = ch;
+            if(filled == 64){
+                compress();
+                filled = 0;
+            }
+        }
+        length += bytes.size();
+        return *this;
+    }
+
+    // the digest in hex, call it once
+    string hex(){
+        uint64_t bits = length * 8;
+        *this << string(1, '\x80');
+        while(filled != 56){
+            *this << string(1, '\0');
+        }
+        for(int i = 7; i >= 0; --i){
+            block[filled++] = (unsigned char)(bits >> 8 * i);
+        }
+        compress();
+
+        string digest;
+        static const char *digits = "0123456789abcdef";
+        for(uint32_t word : state){
+            for(int i = 28; i >= 0; i -= 4){
+                digest += digits[word >> i & 15];
+            }
+        }
+        return digest;
+    }
+
+    private:
+        uint32_t state[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+        };
+        unsigned char block[64];
+        unsigned long filled = 0;
+        uint64_t length = 0;
+
+        static uint32_t rotate(uint32_t x, int n){
+            return x >> n | x << (32 - n);
+        }
+
+        void compress(){
+            static const uint32_t k[64] = {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+            };
+            uint32_t w[64];
+            for(int i = 0; i < 16; ++i){
+                w[i] = (uint32_t)block[4 * i] << 24 | block[4 * i + 1] << 16 | block[4 * i + 2] << 8 | block[4 * i + 3];
+            }
+            for(int i = 16; i < 64; ++i){
+                uint32_t s0 = rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ w[i - 15] >> 3;
+                uint32_t s1 = rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ w[i - 2] >> 10;
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for(int i = 0; i < 64; ++i){
+                uint32_t t1 = h + (rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25)) + (e & f ^ ~e & g) + k[i] + w[i];
+                uint32_t t2 = (rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22)) + (a & b ^ a & c ^ b & c);
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+};
+
+
+// a directory of files named by their key. an entry is written to a temporary file and renamed into
+// place, so a compile that dies halfway or runs next to another never leaves a torn entry behind. with
+// a limit, the entries used least recently (their modification time, which a hit renews) are evicted
+struct DiskCache {
+    DiskCache(string directory, unsigned long limit = 0) : directory(std::move(directory)), limit(limit) {
+        error_code error;
+        filesystem::create_directories(this->directory, error);
+        if(error){
+            cerr << "couldn't create the cache directory " << this->directory << ": " << error.message() << "\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    optional<string> get(const string& key){
+        ifstream file{directory / key, ios::binary | ios::ate};
+        if(!file){
+            return {};
+        }
+        string bytes(file.tellg(), '\0');
+        file.seekg(0);
+        if(!file.read(bytes.data(), bytes.size())){
+            return {};
+        }
+        if(limit){
+            error_code ignored;
+            filesystem::last_write_time(directory / key, filesystem::file_time_type::clock::now(), ignored);
+        }
+        return bytes;
+    }
+
+    // a cache that can't be written to only costs time, so failures are ignored
+    void put(const string& key, const string& bytes){
+        auto temporary = directory / (key + "." + to_string(random_device{}()) + ".tmp");
+        {
+            ofstream file{temporary, ios::binary};
+            file << bytes;
+            if(!file.flush()){
+                file.close();
+                error_code ignored;
+                filesystem::remove(temporary, ignored);
+                return;
+            }
+        }
+        error_code error;
+        filesystem::rename(temporary, directory / key, error);
+        if(error){
+            filesystem::remove(temporary, error);
+        }
+        if(limit){
+            evict();
+        }
+    }
+
+    private:
+        filesystem::path directory;
+        unsigned long limit;
+
+        // another compile's temporary files are left alone, they are renamed in shortly
+        void evict(){
+            vector<pair<filesystem::file_time_type, filesystem::path>> entries;
+            error_code error;
+            for(auto& entry : filesystem::directory_iterator(directory, error)){
+                if(entry.path().extension() != ".tmp"){
+                    entries.push_back({entry.last_write_time(error), entry.path()});
+                }
+            }
+            if(entries.size() <= limit){
+                return;
+            }
+            sort(entries.begin(), entries.end());
+            for(unsigned long i = 0; i < entries.size() - limit; ++i){
+                filesystem::remove(entries[i].second, error);
+            }
+        }
+};
@@ -0,0 +1,238 @@
+#include <vector>
+#include <string>
+#include <optional>
+#include <cstdint>
+
+using namespace std;
+
+
+// constant folding with the same i32 semantics the generated wasm has: arithmetic wraps,
+// shift counts are masked, and anything that would trap (division by zero, INT_MIN / -1) is left for runtime
+struct Folder {
+    unsigned long folded = 0;
+
+    Folder(Program& program){
+        for(auto& f : program.functions){
+            fold(f.body);
+        }
+    }
+
+    Folder(Function& f){
+        fold(f.body);
+    }
+
+    static optional<int32_t> constant(const Expr& e){
+        auto *lit = get_if<IntegerLiteral>(&e);
+        if(!lit || lit->value.empty() || lit->value.size() > 11){
+            return {};
+        }
+        long long value = stoll(lit->value);
+        if(value < INT32_MIN || value > UINT32_MAX){ // wat accepts the unsigned spelling too
+            return {};
+        }
+        return (int32_t)(uint32_t)value;
+    }
+
+    // the value of an expression made only of literals, without folding it in place. nothing that would trap.
+    // operands first, on a stack of its own, as an initializer can nest as deep as any expression
+    static optional<int32_t> value(const Expr& root){
+        vector<pair<const Expr*, bool>> stack{{&root, false}};     // and whether its operands are done
+        vector<optional<int32_t>> values;
+        while(!stack.empty()){
+            auto [e, finishing] = stack.back();
+            stack.pop_back();
+            auto *unop = get_if<UnaryOperation>(e);
+            auto *binop = get_if<BinaryOperation>(e);
+            if(!finishing && (unop || binop)){
+                stack.push_back({e, true});
+                auto *operands = e->children();
+                for(auto it = operands->rbegin(); it != operands->rend(); ++it){
+                    stack.push_back({&*it, false});
+                }
+            }
+            else if(unop){
+                optional<int32_t>& operand = values.back();    // becomes the result
+                if(operand){
+                    uint32_t v = *operand;
+                    if(unop->opcode == "-") operand = (int32_t)(0u - v);
+                    else if(unop->opcode == "~") operand = (int32_t)~v;
+                    else if(unop->opcode == "!") operand = v == 0;
+                    else if(unop->opcode != "+") operand = nullopt;
+                }
+            }
+            else if(binop){
+                auto rhs = values.back();
+                values.pop_back();
+                auto lhs = values.back();
+                values.pop_back();
+                auto result = lhs && rhs ? evaluate(binop->opcode, *lhs, *rhs) : nullopt;
+                values.push_back(result ? optional<int32_t>{(int32_t)*result} : nullopt);
+            }
+            else{
+                values.push_back(constant(*e));
+            }
+        }
+        return values.back();
+    }
+
+    // a parameter can only be replaced by its value if it is never assigned or shadowed
+    static bool substitutable(Block& body, const Parameter& p){
+        if(p.is_array()){
+            return false;
+        }
+        bool ok = true;
+        walk_statements(body, [&](Stmt& s){
+            if(auto *assign = get_if<Assign>(&s)){
+                auto *var = get_if<VariableAccess>(&assign->lhs);
+                ok = ok && !(var && var->name == p.name);
+            }
+            else if(auto *let = get_if<Let>(&s)){
+                for(auto& dec : let->declarations){
+                    ok = ok && dec.name != p.name;
+                }
+            }
+        });
+        return ok;
+    }
+
+    static void substitute(Block& body, const string& name, int32_t value){
+        walk(body, [&](Expr& e){
+            auto *var = get_if<VariableAccess>(&e);
+            if(var && var->name == name){
+                e = IntegerLiteral{to_string(value)};
+            }
+        }, false);
+    }
+
+    private:
+
+    void fold(Block& b){
+        walk(b, [&](Expr& e){ fold(e); });
+
+        walk_statements(b, [&](Stmt& s){
+            auto *branch = get_if<If>(&s);
+            if(!branch){
+                return;
+            }
+            if(auto cond = constant(branch->cond)){
+                ++folded;
+                Block taken = std::move(*cond ? branch->if_body : branch->else_body);
+                s = std::move(taken);
+            }
+        });
+    }
+
+    void fold(Expr& e){
+        if(auto *inlined = get_if<InlinedCall>(&e)){
+            fold(*inlined);
+            fold_returning_constant(e);
+        }
+        else if(auto *unop = get_if<UnaryOperation>(&e)){
+            auto value = constant(unop->lhs[0]);
+            if(unop->opcode == "+"){
+                Expr operand = std::move(unop->lhs[0]);
+                e = std::move(operand);
+                ++folded;
+            }
+            else if(value){
+                uint32_t v = *value;
+                if(unop->opcode == "-") v = 0u - v;
+                else if(unop->opcode == "~") v = ~v;
+                else if(unop->opcode == "!") v = v == 0;
+                else return;
+                replace(e, v);
+            }
+        }
+        else if(auto *binop = get_if<BinaryOperation>(&e)){
+            auto lhs = constant(binop->args[0]), rhs = constant(binop->args[1]);
+            if(lhs && rhs){
+                if(auto value = evaluate(binop->opcode, *lhs, *rhs)){
+                    replace(e, *value);
+                }
+                return;
+            }
+
+            // x + 0, x * 1 and friends keep x (x still runs, so its side effects stay)
+            const string& op = binop->opcode;
+            if(rhs && (*rhs == 0 && (op == "+" || op == "-" || op == "|" || op == "^" || op == "<<" || op == ">>")
+                    || *rhs == 1 && (op == "*" || op == "/"))){
+                Expr operand = std::move(binop->args[0]);
+                e = std::move(operand);
+                ++folded;
+            }
+            else if(lhs && (*lhs == 0 && (op == "+" || op == "|" || op == "^") || *lhs == 1 && op == "*")){
+                Expr operand = std::move(binop->args[1]);
+                e = std::move(operand);
+                ++folded;
+            }
+        }
+    }
+
+    // constant arguments propagate into the inlined body, and a body reduced to
+    // return <constant> replaces the whole call
+    void fold(InlinedCall& call){
+        bool changed = false;
+        for(unsigned long i = 0; i < call.parameters.size(); ){
+            auto value = constant(call.arguments[i]);
+            if(value && substitutable(call.body, call.parameters[i])){
+                substitute(call.body, call.parameters[i].name, *value);
+                call.parameters.erase(call.parameters.begin() + i);
+                call.arguments.erase(call.arguments.begin() + i);
+                changed = true;
+                ++folded;
+            }
+            else{
+                ++i;
+            }
+        }
+        if(changed){
+            fold(call.body);
+        }
+    }
+
+    void fold_returning_constant(Expr& e){
+        auto *call = get_if<InlinedCall>(&e);
+        if(!call || !call->parameters.empty() || call->body.body.size() != 1){
+            return;
+        }
+        auto *ret = get_if<Return>(&call->body.body[0]);
+        if(ret && constant(ret->return_value)){
+            Expr value = std::move(ret->return_value);
+            e = std::move(value);
+            ++folded;
+        }
+    }
+
+    void replace(Expr& e, uint32_t value){
+        e = IntegerLiteral{to_string((int32_t)value)};
+        ++folded;
+    }
+
+    static optional<uint32_t> evaluate(const string& op, int32_t lhs, int32_t rhs){
+        uint32_t a = lhs, b = rhs;
+        if(op == "+") return a + b;
+        if(op == "-") return a - b;
+        if(op == "*") return a * b;
+        if(op == "&") return a & b;
+        if(op == "|") return a | b;
+        if(op == "^") return a ^ b;
+        if(op == "<<") return a << (b & 31);
+        if(op == ">>") return (uint32_t)(lhs >> (b & 31));
+        if(op == "<") return lhs < rhs;
+        if(op == ">") return lhs > rhs;
+        if(op == "<=") return lhs <= rhs;
+        if(op == ">=") return lhs >= rhs;
+        if(op == "==") return lhs == rhs;
+        if(op == "!=") return lhs != rhs;
+        if(op == "/" || op == "%"){
+            if(rhs == 0 || op == "/" && lhs == INT32_MIN && rhs == -1){
+                return {};
+            }
+            if(rhs == -1){ // INT_MIN % -1 is 0 in wasm, avoid the host trap
+                return op == "/" ? 0u - a : 0u;
+            }
+            return op == "/" ? (uint32_t)(lhs / rhs) : (uint32_t)(lhs % rhs);
+        }
+        return {};
+    }
+};
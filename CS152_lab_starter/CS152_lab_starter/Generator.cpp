@@ -0,0 +1,181 @@
+#include <vector>
+#include <string>
+#include <iostream>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+
+// made up programs of about a given size, the same bytes every time for the same shape and size, to
+// benchmark the compiler on inputs far bigger than anyone writes by hand. they follow Spec.txt and
+// build and run: loops count up to an array's length, indices are masked into range, divisors are
+// constants, and function n calls just function (n - 1) / 2, so a run stays short and shallow. shapes
+//     expressions   long expressions nested a hundred deep
+//     functions     many small functions
+//     locals        functions with a couple hundred locals each
+//     arrays        big arrays, initializers and loops over them
+//     mixed         the four in turn
+struct Generator {
+    static inline const vector<string> shapes = {"expressions", "functions", "locals", "arrays", "mixed"};
+
+    string source;
+
+    Generator(const string& shape, unsigned long size) : shape(shape) {
+        if(find(shapes.begin(), shapes.end(), shape) == shapes.end()){
+            cerr << "no program shape called " << shape << "\n";
+            exit(EXIT_FAILURE);
+        }
+        source.reserve(size + 4096);
+        while(source.size() < size){
+            gen_function();
+        }
+        locals = arrays = depth = 0;
+        parameters.push_back(0);
+        source += "main() {\n    print(" + call(parameters.size() - 1) + ")\n}\n";
+    }
+
+    private:
+        string shape;
+        mt19937_64 random{152};     // its output is fixed by the standard, unlike the distributions'
+        vector<unsigned long> parameters;   // of each function so far
+        unsigned long locals = 0, arrays = 0, array_size = 16, depth = 0;
+
+        unsigned long pick(unsigned long n){
+            return random() % n;
+        }
+
+        string number(){
+            return to_string(pick(1000));
+        }
+
+        string variable(){
+            if(!locals){ // main's arguments
+                return number();
+            }
+            return pick(2) ? "v" + to_string(pick(locals)) : "p" + to_string(pick(parameters.back()));
+        }
+
+        // an element, its index masked into the array
+        string element(){
+            return "a" + to_string(pick(arrays)) + "[(" + expression(min(depth, 2ul)) + ") & " + to_string(array_size - 1) + "]";
+        }
+
+        // the function below f, the one it calls, or 1 for the first
+        string call(unsigned long f){
+            if(f == 0){
+                return "1";
+            }
+            unsigned long callee = (f - 1) / 2;
+            string args;
+            for(unsigned long i = 0; i < parameters[callee]; ++i){
+                args += (i ? ", " : "") + expression(1);
+            }
+            return "f" + to_string(callee) + "(" + args + ")";
+        }
+
+        // nested exactly depth deep. one side of a binary operation goes all the way down, the other
+        // stays shallow, so an expression's size grows with its depth rather than doubling with it
+        string expression(unsigned long depth){
+            static const char *operators[] = {"+", "-", "*", "&", "|", "^", "<", ">", "<=", ">=", "==", "!="};
+            static const char *by_constant[] = {" / 7", " % 13", " << 2", " >> 1"};
+            switch(depth ? 3 + pick(4) : pick(3)){
+                case 0:
+                    return number();
+                case 1:
+                    return variable();
+                case 2:
+                    return arrays ? element() : variable();
+                case 3:
+                    return string(1, "+-~!"[pick(4)]) + expression(depth - 1);
+                case 4:
+                    return "(" + expression(depth - 1) + ")";
+                case 5:
+                    return "(" + expression(depth - 1) + ")" + by_constant[pick(4)];
+                default:
+                    if(pick(2)){
+                        return expression(depth - 1) + " " + operators[pick(12)] + " " + expression(min(depth - 1, 1ul));
+                    }
+                    return expression(min(depth - 1, 1ul)) + " " + operators[pick(12)] + " (" + expression(depth - 1) + ")";
+            }
+        }
+
+        // statements at nesting level, loops use the counter i<level>, which nothing else assigns
+        void gen_statements(unsigned long count, unsigned long level){
+            string indent(4 * level + 4, ' ');
+            for(unsigned long s = 0; s < count; ++s){
+                unsigned long kind = pick(10);
+                if(kind < 2 && level < 2){
+                    source += indent + "if " + expression(min(depth, 3ul)) + " {\n";
+                    gen_statements(2, level + 1);
+                    source += indent + "}\n";
+                    if(pick(2)){
+                        source += indent + "else {\n";
+                        gen_statements(2, level + 1);
+                        source += indent + "}\n";
+                    }
+                }
+                else if(kind < 3 && level < 2 && arrays){
+                    string i = "i" + to_string(level), bound = level ? "16" : to_string(array_size);
+                    source += indent + i + " = 0\n";
+                    source += indent + "loop {\n";
+                    source += indent + "    if " + i + " >= " + bound + " {\n" + indent + "        break\n" + indent + "    }\n";
+                    source += indent + "    a" + to_string(pick(arrays)) + "[" + i + "] = " + expression(depth) + "\n";
+                    gen_statements(1, level + 1);
+                    source += indent + "    " + i + " = " + i + " + 1\n";
+                    source += indent + "}\n";
+                }
+                else if(kind < 6 && arrays){
+                    source += indent + element() + " = " + expression(depth) + "\n";
+                }
+                else{
+                    source += indent + "v" + to_string(pick(locals)) + " = " + expression(depth) + "\n";
+                }
+            }
+        }
+
+        void gen_function(){
+            unsigned long f = parameters.size();
+            string kind = shape == "mixed" ? shapes[f % 4] : shape;
+            unsigned long statements;
+            if(kind == "expressions"){
+                locals = 4, arrays = 0, depth = 100, statements = 2;
+            }
+            else if(kind == "functions"){
+                locals = 1, arrays = 0, depth = 2, statements = 1;
+            }
+            else if(kind == "locals"){
+                locals = 200, arrays = 0, depth = 2, statements = 100;
+            }
+            else{
+                locals = 2, arrays = 2, array_size = 256, depth = 2, statements = 12;
+            }
+            if(kind != "arrays"){
+                array_size = 16;
+            }
+            parameters.push_back(1 + pick(3));
+
+            source += "f" + to_string(f) + "(";
+            for(unsigned long i = 0; i < parameters.back(); ++i){
+                source += (i ? ", p" : "p") + to_string(i);
+            }
+            source += ") {\n    let i0, i1";
+            for(unsigned long i = 0; i < locals; ++i){
+                source += ", v" + to_string(i);
+            }
+            for(unsigned long i = 0; i < arrays; ++i){
+                source += ", a" + to_string(i) + "[" + to_string(array_size) + "]";
+                if(i == 0){ // a table, as programs start theirs
+                    source += " = {";
+                    for(unsigned long e = 0; e < array_size; ++e){
+                        source += (e ? ", " : "") + number();
+                    }
+                    source += "}";
+                }
+            }
+            source += "\n";
+            gen_statements(statements, 0);
+            source += "    return " + expression(depth) + " + " + call(f) + "\n}\n\n";
+        }
+};
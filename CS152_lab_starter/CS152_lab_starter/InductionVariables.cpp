@@ -0,0 +1,359 @@
+#include <vector>
+#include <string>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+
+// induction variable strength reduction. a loop counter i stepped once per iteration by
+// a top level i = i + c turns every a[i + d] in the loop into p[d], where the pointer p starts at
+// a + i * 4 before the loop and steps by 4 * c right after i does. when i is left with no other
+// reads, its exit test compares the pointer against a + n * 4 instead and the counter is removed, as
+// long as that can't overflow where i < n wouldn't. while i stays, an array accessed only once is left
+// alone, its pointer would cost as much as it saves. with only_proven, accesses that still need a
+// bounds check are left alone
+struct InductionVariables {
+    unsigned long reduced = 0, removed = 0;
+
+    InductionVariables(Program& program, bool only_proven = false) : only_proven(only_proven) {
+        for(auto& f : program.functions){
+            counter = 0;
+            top = &f.body;
+            scopes = {{}};
+            for(auto& p : f.parameters){
+                scopes.back()[p.name] = p.is_array();
+            }
+            optimize(f.body);
+        }
+    }
+
+    private:
+        vector<unordered_map<string, bool>> scopes;    // name -> is an array
+        unsigned long counter;
+        Block *top;     // the function's body, or the inlined body being reduced
+        bool only_proven;
+
+        struct Counter {
+            string name;
+            int32_t step;
+            unsigned long increment;    // index of i = i + c in the loop body
+        };
+
+        optional<bool> lookup(const string& name){
+            for(auto it = scopes.rbegin(); it != scopes.rend(); ++it){
+                if(it->contains(name)){
+                    return (*it)[name];
+                }
+            }
+            return {};
+        }
+
+        void optimize(Block& b){
+            scopes.push_back({});
+            for(unsigned long i = 0; i < b.body.size(); ++i){
+                walk_inlined(b.body[i], [&](InlinedCall& call){ optimize(call); });
+                if(auto *let = get_if<Let>(&b.body[i])){
+                    for(auto& dec : let->declarations){
+                        scopes.back()[dec.name] = dec.array_size || dec.pointer;
+                    }
+                }
+                else if(auto *block = get_if<Block>(&b.body[i])){
+                    optimize(*block);
+                }
+                else if(auto *branch = get_if<If>(&b.body[i])){
+                    optimize(branch->if_body);
+                    optimize(branch->else_body);
+                }
+                else if(auto *loop = get_if<Loop>(&b.body[i])){
+                    if(loop->vectorized){ // Codegen expects the Vectorizer's shape
+                        continue;
+                    }
+                    optimize(loop->body);
+                    vector<Stmt> preheader;
+                    auto found = counters(loop->body);
+                    Stmt *before = i ? &b.body[i - 1] : nullptr;
+                    for(auto c = found.rbegin(); c != found.rend(); ++c){ // last first, so earlier indices stay put
+                        reduce(*loop, *c, preheader, start(c->name, before, &b == top));
+                    }
+                    b.body.insert(b.body.begin() + i, make_move_iterator(preheader.begin()), make_move_iterator(preheader.end()));
+                    i += preheader.size();
+                }
+            }
+            scopes.pop_back();
+        }
+
+        // an inlined body sees only the callee's parameters, and its lets start at 0 as a function's do.
+        // reads of its counters can't be outside it
+        void optimize(InlinedCall& call){
+            auto outer = std::move(scopes);
+            Block *outer_top = top;
+            scopes = {{}};
+            top = &call.body;
+            for(auto& p : call.parameters){
+                scopes.back()[p.name] = p.is_array();
+            }
+            optimize(call.body);
+            scopes = std::move(outer);
+            top = outer_top;
+        }
+
+        static optional<int32_t> step(const string& name, Expr& rhs){
+            auto *binop = get_if<BinaryOperation>(&rhs);
+            if(!binop || binop->opcode != "+" && binop->opcode != "-"){
+                return {};
+            }
+            auto *lhs = get_if<VariableAccess>(&binop->args[0]);
+            auto c = Folder::constant(binop->args[1]);
+            if(!lhs || lhs->name != name || !c || *c == INT32_MIN){
+                return {};
+            }
+            return binop->opcode == "+" ? *c : -*c;
+        }
+
+        vector<Counter> counters(Block& body){
+            unordered_map<string, unsigned long> assignments;
+            unordered_set<string> declared;
+            walk_statements(body, [&](Stmt& s){
+                if(auto *assign = get_if<Assign>(&s)){
+                    if(auto *var = get_if<VariableAccess>(&assign->lhs)){
+                        ++assignments[var->name];
+                    }
+                }
+                else if(auto *let = get_if<Let>(&s)){
+                    for(auto& dec : let->declarations){
+                        declared.insert(dec.name);
+                    }
+                }
+            });
+
+            vector<Counter> found;
+            for(unsigned long k = 0; k < body.body.size(); ++k){
+                auto *assign = get_if<Assign>(&body.body[k]);
+                auto *var = assign ? get_if<VariableAccess>(&assign->lhs) : nullptr;
+                if(!var || assignments[var->name] != 1 || declared.contains(var->name) || lookup(var->name) != false){
+                    continue;
+                }
+                if(auto c = step(var->name, assign->rhs); c && *c != 0 && *c > -(1 << 28) && *c < (1 << 28)){
+                    found.push_back(Counter{var->name, *c, k});
+                }
+            }
+            return found;
+        }
+
+        // the read of i an exit test makes, with the bound it is compared against
+        struct Compare {
+            BinaryOperation *binop;
+            bool counter_on_left;
+        };
+
+        bool invariant(Expr& e, Block& body){
+            if(holds_alternative<IntegerLiteral>(e)){
+                return true;
+            }
+            auto *var = get_if<VariableAccess>(&e);
+            if(!var || lookup(var->name) != false){
+                return false;
+            }
+            bool assigned = false;
+            walk_statements(body, [&](Stmt& s){
+                if(auto *assign = get_if<Assign>(&s)){
+                    auto *lhs = get_if<VariableAccess>(&assign->lhs);
+                    assigned = assigned || lhs && lhs->name == var->name;
+                }
+                else if(auto *let = get_if<Let>(&s)){
+                    for(auto& dec : let->declarations){
+                        assigned = assigned || dec.name == var->name;
+                    }
+                }
+            });
+            return !assigned;
+        }
+
+        // i's value going into the loop, when the statement before it sets it to a constant, or is the
+        // function's (or inlined body's) let that declares it
+        static optional<int32_t> start(const string& i, Stmt *before, bool top){
+            if(auto *assign = before ? get_if<Assign>(before) : nullptr){
+                auto *var = get_if<VariableAccess>(&assign->lhs);
+                return var && var->name == i ? Folder::constant(assign->rhs) : nullopt;
+            }
+            if(auto *let = before && top ? get_if<Let>(before) : nullptr){
+                for(auto& dec : let->declarations){
+                    if(dec.name == i && !dec.array_size){
+                        return 0;
+                    }
+                }
+            }
+            return {};
+        }
+
+        // p >= a + n * 4 only agrees with i >= n while 4 * i fits, so the counter goes only when its one
+        // test is a break at the top of the loop, against a constant n that i steps towards from a
+        // constant start. then i is never further than a step past n or its start, well within range
+        static bool bounded(Loop& loop, const Counter& c, vector<Compare>& compares, optional<int32_t> start){
+            if(compares.size() != 1 || !start){
+                return false;
+            }
+            auto [binop, counter_on_left] = compares[0];
+            auto bound = Folder::constant(binop->args[counter_on_left ? 1 : 0]);
+            auto *guard = loop.body.body.empty() ? nullptr : get_if<If>(&loop.body.body[0]);
+            if(!bound || !guard || &get<BinaryOperation>(guard->cond) != binop || guard->if_body.body.size() != 1
+                    || !holds_alternative<Break>(guard->if_body.body[0]) || !guard->else_body.body.empty()){
+                return false;
+            }
+            string op = binop->opcode;
+            if(!counter_on_left){ // i op n
+                op = op == "<" ? ">" : op == ">" ? "<" : op == "<=" ? ">=" : op == ">=" ? "<=" : op;
+            }
+            bool towards = c.step > 0 ? op == ">=" || op == ">" : op == "<=" || op == "<";
+            auto small = [](int32_t v){ return v > -(1 << 28) && v < (1 << 28); };
+            return towards && small(*bound) && small(*start);
+        }
+
+        void reduce(Loop& loop, const Counter& c, vector<Stmt>& preheader, optional<int32_t> start){
+            const string& i = c.name;
+
+            // every read of i in the loop, sorted into array indices, exit tests and the rest
+            unordered_set<string> declared_in_loop;
+            walk_statements(loop.body, [&](Stmt& s){
+                if(auto *let = get_if<Let>(&s)){
+                    for(auto& dec : let->declarations){
+                        declared_in_loop.insert(dec.name);
+                    }
+                }
+            });
+
+            vector<ArrayAccess*> accesses;
+            vector<Compare> compares;
+            unsigned long reads = 0;
+
+            auto classify = [&](Expr& e){
+                if(auto *var = get_if<VariableAccess>(&e); var && var->name == i){
+                    ++reads;
+                }
+                else if(auto *aa = get_if<ArrayAccess>(&e)){
+                    if(lookup(aa->name) == true && !declared_in_loop.contains(aa->name) && offset(aa->index[0], i)
+                            && (aa->in_bounds || !only_proven)){
+                        accesses.push_back(aa);
+                    }
+                }
+                else if(auto *binop = get_if<BinaryOperation>(&e)){
+                    static const unordered_set<string> relational{"<", ">", "<=", ">=", "==", "!="};
+                    auto *lhs = get_if<VariableAccess>(&binop->args[0]);
+                    auto *rhs = get_if<VariableAccess>(&binop->args[1]);
+                    if(relational.contains(binop->opcode)){
+                        if(lhs && lhs->name == i && invariant(binop->args[1], loop.body)){
+                            compares.push_back(Compare{binop, true});
+                        }
+                        else if(rhs && rhs->name == i && invariant(binop->args[0], loop.body)){
+                            compares.push_back(Compare{binop, false});
+                        }
+                    }
+                }
+            };
+            walk_statements(loop.body, [&](Stmt& s){
+                if(auto *expr = get_if<Expr>(&s)){
+                    walk(*expr, classify, false);
+                }
+                else if(auto *ret = get_if<Return>(&s)){
+                    walk(ret->return_value, classify, false);
+                }
+                else if(auto *branch = get_if<If>(&s)){
+                    walk(branch->cond, classify, false);
+                }
+                else if(auto *assign = get_if<Assign>(&s)){
+                    if(holds_alternative<ArrayAccess>(assign->lhs)){
+                        walk(assign->lhs, classify, false);  // the store's address is one of the accesses
+                    }
+                    walk(assign->rhs, classify, false);
+                }
+            });
+            if(accesses.empty()){
+                return;
+            }
+
+            // reads left once the accesses use pointers: one in i = i + c and one per exit test.
+            // anything more, or any read outside the loop, keeps i
+            unsigned long uses = 0;
+            walk(*top, [&](Expr& e){
+                auto *var = get_if<VariableAccess>(&e);
+                uses += var && var->name == i;
+            }, false);
+            bool dead = reads == accesses.size() + compares.size() + 1 && uses == reads && bounded(loop, c, compares, start);
+
+            // while i stays, a pointer's step costs as much as it saves a single a[i] in wasm, so only
+            // an array accessed more than once gets one
+            if(!dead){
+                unordered_map<string, unsigned long> per_array;
+                for(auto *aa : accesses){
+                    ++per_array[aa->name];
+                }
+                erase_if(accesses, [&](ArrayAccess *aa){ return per_array[aa->name] < 2; });
+                if(accesses.empty()){
+                    return;
+                }
+            }
+
+            // one pointer per array walked with i
+            unordered_map<string, string> pointers;
+            vector<Stmt> steps;
+            string first_array, first_pointer;
+            for(auto *aa : accesses){
+                if(!pointers.contains(aa->name)){
+                    string p = "ptr." + to_string(counter++);
+                    pointers[aa->name] = p;
+                    if(first_pointer.empty()){
+                        first_array = aa->name;
+                        first_pointer = p;
+                    }
+                    VariableDeclarations dec{p, {}};
+                    dec.pointer = true;
+                    preheader.push_back(Let{{dec}});
+                    preheader.push_back(Assign{VariableAccess{p}, scaled(aa->name, VariableAccess{i})});
+                    steps.push_back(Assign{VariableAccess{p}, BinaryOperation{{VariableAccess{p}, IntegerLiteral{to_string(4 * c.step)}}, "+"}});
+                    ++reduced;
+                }
+                int32_t d = *offset(aa->index[0], i);
+                aa->name = pointers[aa->name];
+                aa->index[0] = IntegerLiteral{to_string(d)};
+            }
+
+            if(dead){
+                for(auto& [binop, counter_on_left] : compares){
+                    int bound = counter_on_left ? 1 : 0;
+                    binop->args[1 - bound] = VariableAccess{first_pointer};
+                    binop->args[bound] = scaled(first_array, std::move(binop->args[bound]));
+                }
+                loop.body.body.erase(loop.body.body.begin() + c.increment);
+                ++removed;
+            }
+            loop.body.body.insert(loop.body.body.begin() + c.increment + (dead ? 0 : 1),
+                make_move_iterator(steps.begin()), make_move_iterator(steps.end()));
+        }
+
+        // a + e * 4, the address of a[e]
+        static Expr scaled(const string& array, Expr e){
+            if(auto c = Folder::constant(e)){
+                return BinaryOperation{{VariableAccess{array}, IntegerLiteral{to_string((int32_t)(4u * (uint32_t)*c))}}, "+"};
+            }
+            return BinaryOperation{{VariableAccess{array}, BinaryOperation{{std::move(e), IntegerLiteral{"4"}}, "*"}}, "+"};
+        }
+
+        // d when index is i or i + d
+        static optional<int32_t> offset(Expr& index, const string& i){
+            if(auto *var = get_if<VariableAccess>(&index)){
+                return var->name == i ? optional<int32_t>{0} : nullopt;
+            }
+            auto *binop = get_if<BinaryOperation>(&index);
+            if(!binop || binop->opcode != "+"){
+                return {};
+            }
+            auto *var = get_if<VariableAccess>(&binop->args[0]);
+            auto d = Folder::constant(binop->args[1]);
+            if(var && var->name == i && d && *d > -(1 << 28) && *d < (1 << 28)){
+                return d;
+            }
+            return {};
+        }
+};
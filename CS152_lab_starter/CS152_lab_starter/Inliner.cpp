@@ -0,0 +1,233 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+using namespace std;
+
+
+// splices small or single call site functions into their callers.
+// callees are finished before their callers so an inlined body is already inlined itself,
+// Codegen gives every inlined local its own mangled name and stack slot in the caller's frame.
+// a single call site's body is moved rather than copied, the function goes anyway. copies of small
+// ones can add at most as many nodes as the program had (or 1000, in a small one). the later passes
+// and the backends recurse into an inlined body, so they nest at most max_depth deep
+struct Inliner {
+    stringstream report;
+
+    Inliner(Program& program, unsigned long budget) : budget(budget) {
+        unsigned long total = 0;
+        for(auto& f : program.functions){
+            functions[f.name] = &f;
+            walk_statements(f.body, [&](Stmt&){ ++statements[f.name]; });
+            walk(f.body, [&](Expr&){ ++expressions[f.name]; });
+            total += size(f.name);
+        }
+        growth = max(total, 1000ul);
+        for(auto& f : program.functions){
+            for(auto& callee : calls_in(f.body)){
+                ++call_sites[callee];
+                callees[f.name].insert(callee);
+            }
+        }
+        find_recursive();
+
+        // callees before callers, on a stack of its own as a chain of calls can be as long as the program
+        for(auto& f : program.functions){
+            vector<pair<string, bool>> work{{f.name, false}};   // and whether its callees are done
+            while(!work.empty()){
+                auto [name, callees_done] = work.back();
+                work.pop_back();
+                if(finished.contains(name)){
+                    continue;
+                }
+                if(callees_done){
+                    inline_into(*functions[name]);
+                    finished.insert(name);
+                    continue;
+                }
+                if(!in_progress.insert(name).second){ // a cycle, recursive calls aren't inlined
+                    continue;
+                }
+                work.push_back({name, true});
+                for(auto& callee : callees[name]){
+                    if(functions.contains(callee) && !finished.contains(callee)){
+                        work.push_back({callee, false});
+                    }
+                }
+            }
+        }
+
+        remove_dead(program);
+    }
+
+    private:
+        static constexpr unsigned long max_depth = 256;
+
+        unsigned long budget, growth, copied = 0;   // nodes copies may add, and have
+        unordered_map<string, Function*> functions;
+        unordered_map<string, unsigned long> call_sites, depths;
+        // a function's size is its own statements and its expressions, with those of what was inlined into it.
+        // kept up to date as calls are inlined, rather than walking each body again
+        unordered_map<string, unsigned long> statements, expressions;
+        unordered_map<string, unordered_set<string>> callees;
+        unordered_set<string> recursive, finished, in_progress, inlined;
+
+        static vector<string> calls_in(Block& b){
+            vector<string> names;
+            walk(b, [&](Expr& e){
+                if(auto *call = get_if<FunctionCall>(&e)){
+                    names.push_back(call->name);
+                }
+            });
+            return names;
+        }
+
+        // the functions on a cycle of calls, the strongly connected components (Tarjan's) of more than one
+        // function or of one that calls itself. once over the calls, on a stack of its own
+        void find_recursive(){
+            struct Visiting {
+                string name;
+                vector<string> callees;
+                unsigned long next = 0;
+            };
+            unordered_map<string, unsigned long> index, low;
+            vector<string> stack;
+            unordered_set<string> on_stack;
+            for(auto& [root, f] : functions){
+                if(index.contains(root)){
+                    continue;
+                }
+                vector<Visiting> visiting;
+                auto enter = [&](const string& name){
+                    unsigned long i = index.size();
+                    index[name] = low[name] = i;
+                    stack.push_back(name);
+                    on_stack.insert(name);
+                    visiting.push_back({name, {callees[name].begin(), callees[name].end()}});
+                };
+                enter(root);
+                while(!visiting.empty()){
+                    Visiting& top = visiting.back();
+                    if(top.next < top.callees.size()){
+                        string callee = top.callees[top.next++];
+                        if(!functions.contains(callee)){ // runtime imports
+                            continue;
+                        }
+                        if(!index.contains(callee)){
+                            enter(callee);
+                        }
+                        else if(on_stack.contains(callee)){
+                            low[top.name] = min(low[top.name], index[callee]);
+                        }
+                        continue;
+                    }
+
+                    string name = std::move(top.name);
+                    visiting.pop_back();
+                    if(!visiting.empty()){
+                        low[visiting.back().name] = min(low[visiting.back().name], low[name]);
+                    }
+                    if(low[name] != index[name]){
+                        continue;
+                    }
+                    vector<string> component;
+                    do{
+                        component.push_back(std::move(stack.back()));
+                        stack.pop_back();
+                        on_stack.erase(component.back());
+                    } while(component.back() != name);
+                    if(component.size() > 1 || callees[name].contains(name)){
+                        recursive.insert(component.begin(), component.end());
+                    }
+                }
+            }
+        }
+
+        unsigned long size(const string& name){
+            return statements[name] + expressions[name];
+        }
+
+        void inline_into(Function& f){
+            walk(f.body, [&](Expr& e){
+                auto *call = get_if<FunctionCall>(&e);
+                if(!call || !should_inline(f.name, *call)){
+                    return;
+                }
+                Function& callee = *functions[call->name];
+                inlined.insert(callee.name);
+                expressions[f.name] += expressions[callee.name];
+                depths[f.name] = max(depths[f.name], depths[callee.name] + 1);
+                if(call_sites[callee.name] == 1){
+                    e = InlinedCall{callee.name, callee.parameters, std::move(call->arguments), std::move(callee.body)};
+                }
+                else{
+                    copied += size(callee.name);
+                    e = InlinedCall{callee.name, callee.parameters, std::move(call->arguments), callee.body};
+                }
+            }, false);
+        }
+
+        bool should_inline(const string& caller, FunctionCall& call){
+            if(!functions.contains(call.name)){ // runtime imports
+                return false;
+            }
+            Function& callee = *functions[call.name];
+            report << caller << " -> " << callee.name << ": ";
+
+            if(recursive.contains(callee.name)){
+                report << "kept, recursive\n";
+                return false;
+            }
+            if(callee.name == "main"){
+                report << "kept, main is exported\n";
+                return false;
+            }
+            if(call.arguments.size() != callee.parameters.size()){
+                report << "kept, " << call.arguments.size() << " arguments for " << callee.parameters.size() << " parameters\n";
+                return false;
+            }
+
+            if(depths[callee.name] + 1 > max_depth){
+                report << "kept, its body already has calls inlined " << max_depth << " deep\n";
+                return false;
+            }
+
+            unsigned long n = size(callee.name);
+            if(call_sites[callee.name] == 1){
+                report << "inlined, single call site (size " << n << ")\n";
+                return true;
+            }
+            if(n > budget){
+                report << "kept, size " << n << " > budget " << budget << " with " << call_sites[callee.name] << " call sites\n";
+                return false;
+            }
+            if(copied + n > growth){
+                report << "kept, the program has grown by " << copied << " nodes of " << growth << "\n";
+                return false;
+            }
+            report << "inlined, size " << n << " <= budget " << budget << "\n";
+            return true;
+        }
+
+        // a function that was inlined and is no longer called from anywhere doesn't need its own copy
+        void remove_dead(Program& program){
+            unordered_set<string> live{"main"};
+            for(auto& f : program.functions){
+                for(auto& callee : calls_in(f.body)){
+                    live.insert(callee);
+                }
+            }
+            vector<Function> kept;
+            for(auto& f : program.functions){
+                if(inlined.contains(f.name) && !live.contains(f.name)){
+                    report << "removed " << f.name << ", every call site was inlined\n";
+                    continue;
+                }
+                kept.push_back(std::move(f));
+            }
+            program.functions = std::move(kept);
+        }
+};
@@ -0,0 +1,165 @@
+#include <vector>
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+
+// runs a Program natively for --run, no browser or wasm engine needed. the Bytecode is executed by a
+// threaded loop that jumps straight from one handler to the next (computed goto, a GNU extension
+// clang++ and g++ both have). print/putch write to stdout, traps stop with V8's message. as the
+// semantics are the generated wasm's, it is a reference to check the wasm output against
+struct Interpreter {
+    Interpreter(Program& program, bool bounds_check = false) : bytecode(program, bounds_check) {}
+
+    // calls main, its return value is what the exported main would give back
+    int32_t run(){
+        if(!bytecode.function_index.contains("main")){
+            cerr << "no main function to run\n";
+            exit(EXIT_FAILURE);
+        }
+
+        struct Frame {
+            const Instruction *ip;
+            size_t base;            // of the caller's registers
+            int32_t dst;
+            const Compiled *function;
+        };
+        static constexpr size_t max_depth = 1 << 16;
+
+        vector<uint8_t> memory(1 << 16);
+        vector<int32_t> registers(1 << 16);
+        vector<Frame> frames;
+        uint32_t sp = 0;
+
+        const Compiled *function = &bytecode.functions[bytecode.function_index["main"]];
+        if(function->registers > registers.size()){
+            registers.resize(function->registers);
+        }
+        int32_t *r = registers.data();
+        const Instruction *ip = function->code.data();
+        sp += function->frame_bytes;
+
+        auto at = [&](uint32_t base, int32_t imm, uint32_t bytes = 4) -> uint8_t* {
+            uint64_t address = (uint64_t)base + (uint32_t)imm;
+            if(address + bytes > memory.size()){
+                Bytecode::trap("memory access out of bounds");
+            }
+            return memory.data() + address;
+        };
+
+        static const void *dispatch[] = {
+            &&Const, &&Move, &&Add, &&AddImm, &&Sub, &&Mul, &&Div, &&Rem, &&And, &&Or, &&Xor, &&Shl, &&Shr,
+            &&Lt, &&Gt, &&Le, &&Ge, &&Eq, &&Ne, &&Neg, &&Not, &&Eqz,
+            &&Load, &&LoadAt, &&Store, &&StoreAt, &&Check, &&Array, &&Fill, &&Copy,
+            &&Jump, &&JumpZero, &&Call, &&Print, &&Putch, &&Puts, &&Return,
+        };
+        #define NEXT() goto *dispatch[(int)ip->op]
+        #define BINARY(name, expression) name: { uint32_t a = r[ip->b], b = r[ip->c]; r[ip->a] = (int32_t)(expression); ++ip; NEXT(); }
+        #define COMPARE(name, op) name: r[ip->a] = r[ip->b] op r[ip->c]; ++ip; NEXT();
+
+        NEXT();
+
+        Const: r[ip->a] = ip->imm; ++ip; NEXT();
+        Move: r[ip->a] = r[ip->b]; ++ip; NEXT();
+        AddImm: r[ip->a] = (int32_t)((uint32_t)r[ip->b] + (uint32_t)ip->imm); ++ip; NEXT();
+        BINARY(Add, a + b)
+        BINARY(Sub, a - b)
+        BINARY(Mul, a * b)
+        BINARY(And, a & b)
+        BINARY(Or, a | b)
+        BINARY(Xor, a ^ b)
+        BINARY(Shl, a << (b & 31))
+        BINARY(Shr, (int32_t)a >> (b & 31))
+        Div:
+            if(r[ip->c] == 0) Bytecode::trap("divide by zero");
+            if(r[ip->b] == INT32_MIN && r[ip->c] == -1) Bytecode::trap("divide result unrepresentable");
+            r[ip->a] = r[ip->b] / r[ip->c];
+            ++ip; NEXT();
+        Rem:
+            if(r[ip->c] == 0) Bytecode::trap("divide by zero");
+            r[ip->a] = r[ip->c] == -1 ? 0 : r[ip->b] % r[ip->c];
+            ++ip; NEXT();
+        COMPARE(Lt, <)
+        COMPARE(Gt, >)
+        COMPARE(Le, <=)
+        COMPARE(Ge, >=)
+        COMPARE(Eq, ==)
+        COMPARE(Ne, !=)
+        Neg: r[ip->a] = (int32_t)(0u - (uint32_t)r[ip->b]); ++ip; NEXT();
+        Not: r[ip->a] = ~r[ip->b]; ++ip; NEXT();
+        Eqz: r[ip->a] = r[ip->b] == 0; ++ip; NEXT();
+
+        Load: memcpy(&r[ip->a], at(r[ip->b] + 4u * r[ip->c], ip->imm), 4); ++ip; NEXT();
+        LoadAt: memcpy(&r[ip->a], at(r[ip->b], ip->imm), 4); ++ip; NEXT();
+        Store: memcpy(at(r[ip->a] + 4u * r[ip->b], ip->imm), &r[ip->c], 4); ++ip; NEXT();
+        StoreAt: memcpy(at(r[ip->a], ip->imm), &r[ip->c], 4); ++ip; NEXT();
+        Check:
+            if((uint32_t)r[ip->a] >= (uint32_t)ip->imm) Bytecode::trap("unreachable");
+            ++ip; NEXT();
+        Array: r[ip->a] = (int32_t)(sp - (uint32_t)ip->imm); ++ip; NEXT();
+        Fill: memset(at(r[ip->a] + (uint32_t)ip->b, 0, ip->imm), 0, ip->imm); ++ip; NEXT();
+        Copy: {
+            const string& table = bytecode.strings[ip->imm];
+            memcpy(at(r[ip->a], 0, table.size()), table.data(), table.size());
+            ++ip; NEXT();
+        }
+
+        Jump: ip = function->code.data() + ip->imm; NEXT();
+        JumpZero:
+            ip = r[ip->a] ? ip + 1 : function->code.data() + ip->imm;
+            NEXT();
+
+        Call: {
+            const Compiled *callee = &bytecode.functions[ip->b];
+            if(frames.size() == max_depth){
+                Bytecode::trap("Maximum call stack size exceeded");
+            }
+            size_t base = r - registers.data();
+            size_t callee_base = base + function->registers;
+            if(callee_base + callee->registers > registers.size()){
+                registers.resize(2 * (callee_base + callee->registers));
+                r = registers.data() + base;
+            }
+            int32_t *callee_r = registers.data() + callee_base;
+            memcpy(callee_r, r + ip->c, 4 * callee->parameters);
+            fill(callee_r + callee->parameters, callee_r + callee->locals, 0);
+
+            frames.push_back(Frame{ip + 1, base, ip->a, function});
+            sp += callee->frame_bytes;
+            function = callee;
+            r = callee_r;
+            ip = callee->code.data();
+            NEXT();
+        }
+        Print: cout << r[ip->b] << "\n"; r[ip->a] = 0; ++ip; NEXT();
+        Putch: cout.put((char)r[ip->b]); r[ip->a] = 0; ++ip; NEXT();
+        Puts: cout << bytecode.strings[ip->imm]; r[ip->a] = 0; ++ip; NEXT();
+        Return: {
+            int32_t value = r[ip->a];
+            sp -= function->frame_bytes;
+            if(frames.empty()){
+                cout.flush();
+                return value;
+            }
+            Frame& frame = frames.back();
+            r = registers.data() + frame.base;
+            r[frame.dst] = value;
+            ip = frame.ip;
+            function = frame.function;
+            frames.pop_back();
+            NEXT();
+        }
+        #undef NEXT
+        #undef BINARY
+        #undef COMPARE
+    }
+
+    private:
+        using Instruction = Bytecode::Instruction;
+        using Compiled = Bytecode::Compiled;
+
+        Bytecode bytecode;
+};
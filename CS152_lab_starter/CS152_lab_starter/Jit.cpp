@@ -0,0 +1,692 @@
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <signal.h>
+#endif
+
+using namespace std;
+
+
+#if defined(__x86_64__)
+
+// compiles the Bytecode to x86-64 for --jit and runs it. each bytecode register gets a live range from
+// a liveness pass, and a linear scan hands out rbx, r12 and r13 to ranges that live across a call and
+// rsi, rdi, r8-r11 to the rest, spilling the range that ends last when it runs out. rax, rcx and rdx
+// are scratch, r14 holds the wasm stack pointer and r15 the base of the memory.
+// the memory is the wasm one, 64KiB at the start of an 8GiB reservation, so any 32-bit address plus
+// offset that misses it lands on an inaccessible page and the fault handler reports the trap.
+// code is written into a mapping that is only made executable once it is done, never both at once
+struct Jit {
+    Jit(Program& program, bool bounds_check = false) : bytecode(program, bounds_check, false) {
+        emit_traps();
+        for(auto& f : bytecode.functions){
+            entries.push_back(code.size());
+            compile(f);
+        }
+        for(auto [at, function] : calls){
+            patch(at, entries[function]);
+        }
+        emit_entry();
+    }
+
+    // calls main, its return value is what the exported main would give back
+    int32_t run(){
+        size_t length = (code.size() + 4095) & ~(size_t)4095;
+        void *executable = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        memory = (uint8_t*)mmap(nullptr, reservation, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(executable == MAP_FAILED || memory == MAP_FAILED || mprotect(memory, 1 << 16, PROT_READ | PROT_WRITE)){
+            cerr << "couldn't map memory for the jit\n";
+            exit(EXIT_FAILURE);
+        }
+        memcpy(executable, code.data(), code.size());
+        if(mprotect(executable, length, PROT_READ | PROT_EXEC)){
+            cerr << "couldn't make the jit code executable\n";
+            exit(EXIT_FAILURE);
+        }
+
+        static uint8_t alternate_stack[1 << 16];    // the handler can't run on a stack that overflowed
+        stack_t ss{};
+        ss.ss_sp = alternate_stack;
+        ss.ss_size = sizeof(alternate_stack);
+        sigaltstack(&ss, nullptr);
+        struct sigaction action{};
+        action.sa_sigaction = fault;
+        action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigaction(SIGSEGV, &action, nullptr);
+        sigaction(SIGBUS, &action, nullptr);
+
+        rlimit limit;
+        getrlimit(RLIMIT_STACK, &limit);
+        int marker;
+        stack_top = (uintptr_t)&marker;
+        stack_size = limit.rlim_cur == RLIM_INFINITY ? (uintptr_t)1 << 30 : limit.rlim_cur;
+
+        auto main = (int32_t (*)(uint8_t*))((uint8_t*)executable + entry);
+        int32_t value = main(memory);
+        cout.flush();
+
+        signal(SIGSEGV, SIG_DFL);
+        signal(SIGBUS, SIG_DFL);
+        munmap(memory, reservation);
+        munmap(executable, length);
+        return value;
+    }
+
+    private:
+        using Op = Bytecode::Op;
+        using Instruction = Bytecode::Instruction;
+        using Compiled = Bytecode::Compiled;
+
+        enum Reg { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+        enum Cond { B = 0x2, AE = 0x3, E = 0x4, NE = 0x5, L = 0xC, GE = 0xD, LE = 0xE, G = 0xF };
+        enum Trap { DIVIDE_BY_ZERO, UNREPRESENTABLE, UNREACHABLE, TRAPS };
+
+        static constexpr Reg callee_saved[] = {RBX, R12, R13};
+        static constexpr Reg caller_saved[] = {RSI, RDI, R8, R9, R10, R11};
+        static constexpr size_t reservation = (size_t)8 << 30;    // past 4GiB plus any 31-bit offset
+
+        Bytecode bytecode;
+        vector<uint8_t> code;
+        vector<size_t> entries;                     // code offset of each function
+        vector<pair<size_t, size_t>> calls;         // rel32 to patch, function called
+        size_t traps[TRAPS], entry;
+
+        inline static uint8_t *memory;
+        inline static uintptr_t stack_top, stack_size;
+
+        // where a register lives in the function being compiled
+        struct Location {
+            int reg = -1;
+            int32_t disp = 0;       // off rbp when it was spilled
+            bool at_entry = false;  // live from the prologue on, parameters and locals read before written
+        };
+        vector<Location> where;
+
+        // the machine code, a few bytes at a time
+
+        void byte(uint8_t b){ code.push_back(b); }
+        void dword(uint32_t d){ for(int i = 0; i < 4; ++i) byte(d >> 8 * i); }
+        void qword(uint64_t q){ for(int i = 0; i < 8; ++i) byte(q >> 8 * i); }
+
+        void patch(size_t at, size_t target){
+            uint32_t rel = target - (at + 4);
+            memcpy(&code[at], &rel, 4);
+        }
+
+        void rex(bool w, int reg, int index, int base){
+            uint8_t r = 0x40 | w << 3 | (reg >> 3) << 2 | (index >> 3) << 1 | base >> 3;
+            if(r != 0x40){
+                byte(r);
+            }
+        }
+
+        // opcode with reg and a register operand
+        void rr(initializer_list<uint8_t> opcode, int reg, int rm, bool w = false){
+            rex(w, reg, 0, rm);
+            for(auto b : opcode) byte(b);
+            byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+        }
+
+        // opcode with reg and the memory operand [base + index << scale + disp], index -1 for none
+        void rm(initializer_list<uint8_t> opcode, int reg, int base, int index, int scale, int32_t disp, bool w = false){
+            rex(w, reg, index < 0 ? 0 : index, base);
+            for(auto b : opcode) byte(b);
+            if(index < 0 && (base & 7) != RSP){
+                byte(0x80 | (reg & 7) << 3 | (base & 7));
+            }
+            else{
+                byte(0x84 | (reg & 7) << 3);
+                byte(scale << 6 | (index < 0 ? RSP : index & 7) << 3 | (base & 7));
+            }
+            dword(disp);
+        }
+
+        void mov(int dst, int src){ if(dst != src) rr({0x89}, src, dst); }
+        void mov_imm(int dst, int32_t imm){ rex(false, 0, 0, dst); byte(0xB8 + (dst & 7)); dword(imm); }
+        void mov_imm64(int dst, uint64_t imm){ rex(true, 0, 0, dst); byte(0xB8 + (dst & 7)); qword(imm); }
+        void push(int r){ if(r >= 8) byte(0x41); byte(0x50 + (r & 7)); }
+        void pop(int r){ if(r >= 8) byte(0x41); byte(0x58 + (r & 7)); }
+        void alu_imm(int ext, int r, int32_t imm, bool w = false){ rr({0x81}, ext, r, w); dword(imm); }
+        void call_absolute(const void *function){ mov_imm64(RAX, (uint64_t)function); rr({0xFF}, 2, RAX); }
+
+        size_t jump(){ byte(0xE9); dword(0); return code.size() - 4; }
+        size_t jump_if(Cond cc){ byte(0x0F); byte(0x80 + cc); dword(0); return code.size() - 4; }
+
+        void load(int scratch, int32_t v){
+            Location& l = where[v];
+            if(l.reg >= 0) mov(scratch, l.reg);
+            else rm({0x8B}, scratch, RBP, -1, 0, l.disp);
+        }
+
+        void store(int32_t v, int scratch){
+            Location& l = where[v];
+            if(l.reg >= 0) mov(l.reg, scratch);
+            else rm({0x89}, scratch, RBP, -1, 0, l.disp);
+        }
+
+        // the trap stubs every function jumps to, rsp is 16 byte aligned at any jump
+        void emit_traps(){
+            static const char *messages[] = {"divide by zero", "divide result unrepresentable", "unreachable"};
+            for(int t = 0; t < TRAPS; ++t){
+                traps[t] = code.size();
+                mov_imm64(RDI, (uint64_t)messages[t]);
+                call_absolute((const void*)&Bytecode::trap);
+            }
+        }
+
+        void jump_to_trap(Cond cc, Trap t){
+            patch(jump_if(cc), traps[t]);
+        }
+
+        // entry(memory) sets up r14 and r15 and calls main with zeroed arguments
+        void emit_entry(){
+            entry = code.size();
+            push(RBP);
+            rr({0x89}, RSP, RBP, true);
+            for(Reg r : {RBX, R12, R13, R14, R15}) push(r);
+            alu_imm(5, RSP, 8, true);
+            rr({0x89}, RDI, R15, true);
+            rr({0x31}, R14, R14);
+
+            auto it = bytecode.function_index.find("main");
+            if(it == bytecode.function_index.end()){
+                cerr << "no main function to run\n";
+                exit(EXIT_FAILURE);
+            }
+            size_t n = bytecode.functions[it->second].parameters;
+            size_t pushed = n + n % 2;
+            mov_imm(RAX, 0);
+            for(size_t i = 0; i < pushed; ++i) push(RAX);
+            byte(0xE8);
+            dword(0);
+            patch(code.size() - 4, entries[it->second]);
+
+            rm({0x8D}, RSP, RBP, -1, 0, -40, true);
+            for(Reg r : {R15, R14, R13, R12, RBX}) pop(r);
+            pop(RBP);
+            byte(0xC3);
+        }
+
+        [[noreturn]] static void fault(int, siginfo_t *info, void*){
+            uintptr_t address = (uintptr_t)info->si_addr;
+            if(address >= (uintptr_t)memory && address < (uintptr_t)memory + reservation){
+                Bytecode::trap("memory access out of bounds");     // faults only come from jit code, never halfway through stdio
+            }
+            if(address < stack_top && address + stack_size + (1 << 20) > stack_top){
+                Bytecode::trap("Maximum call stack size exceeded");
+            }
+            signal(SIGSEGV, SIG_DFL);
+            signal(SIGBUS, SIG_DFL);
+            raise(SIGSEGV);
+            _exit(EXIT_FAILURE);
+        }
+
+        static int32_t print(int32_t value){
+            cout << value << "\n";
+            return 0;
+        }
+
+        static int32_t putch(int32_t value){
+            cout.put((char)value);
+            return 0;
+        }
+
+        static int32_t puts_string(const string *text){
+            cout << *text;
+            return 0;
+        }
+
+        static void fill(uint32_t address, uint32_t bytes){
+            if((uint64_t)address + bytes > 1 << 16){
+                Bytecode::trap("memory access out of bounds");
+            }
+            memset(memory + address, 0, bytes);
+        }
+
+        static void copy(uint32_t address, const string *table){
+            if((uint64_t)address + table->size() > 1 << 16){
+                Bytecode::trap("memory access out of bounds");
+            }
+            memcpy(memory + address, table->data(), table->size());
+        }
+
+        // registers an instruction reads and the one it writes (-1 for none)
+        void operands(const Instruction& in, vector<int32_t>& uses, int32_t& def){
+            uses.clear();
+            def = -1;
+            switch(in.op){
+                case Op::Const: case Op::Array: case Op::Puts:
+                    def = in.a;
+                    break;
+                case Op::Move: case Op::AddImm: case Op::Neg: case Op::Not: case Op::Eqz:
+                case Op::LoadAt: case Op::Print: case Op::Putch:
+                    def = in.a;
+                    uses = {in.b};
+                    break;
+                case Op::Store:
+                    uses = {in.a, in.b, in.c};
+                    break;
+                case Op::StoreAt:
+                    uses = {in.a, in.c};
+                    break;
+                case Op::Check: case Op::JumpZero: case Op::Return: case Op::Fill: case Op::Copy:
+                    uses = {in.a};
+                    break;
+                case Op::Jump:
+                    break;
+                case Op::Call:
+                    def = in.a;
+                    for(unsigned long i = 0; i < bytecode.functions[in.b].parameters; ++i){
+                        uses.push_back(in.c + i);
+                    }
+                    break;
+                default:        // binary operations and Load
+                    def = in.a;
+                    uses = {in.b, in.c};
+            }
+        }
+
+        static bool is_call(Op op){
+            return op == Op::Call || op == Op::Print || op == Op::Putch || op == Op::Puts || op == Op::Fill || op == Op::Copy;
+        }
+
+        // live ranges, then a linear scan over them. fills where and returns the spill slots used.
+        // liveness is solved per basic block on sorted lists rather than per instruction on bitsets, an
+        // expression nested a million deep has about as many registers as instructions
+        int32_t allocate(const Compiled& f){
+            size_t n = f.code.size();
+            vector<vector<int32_t>> uses(n);
+            vector<int32_t> defs(n);
+            for(size_t i = 0; i < n; ++i){
+                operands(f.code[i], uses[i], defs[i]);
+            }
+
+            // blocks start at 0, at jump targets, and after jumps and returns
+            vector<bool> leader(n + 1);
+            leader[0] = true;
+            for(size_t i = 0; i < n; ++i){
+                Op op = f.code[i].op;
+                if(op == Op::Jump || op == Op::JumpZero){
+                    leader[f.code[i].imm] = true;
+                }
+                if(op == Op::Jump || op == Op::JumpZero || op == Op::Return){
+                    leader[i + 1] = true;
+                }
+            }
+            vector<size_t> starts, block_of(n);
+            for(size_t i = 0; i < n; ++i){
+                if(leader[i]) starts.push_back(i);
+                block_of[i] = starts.size() - 1;
+            }
+            size_t blocks = starts.size();
+            starts.push_back(n);
+
+            // what each block reads before it writes, and what it writes
+            vector<vector<int32_t>> gen(blocks), kill(blocks);
+            vector<size_t> written(f.registers, SIZE_MAX);     // the last block seen writing it
+            for(size_t b = 0; b < blocks; ++b){
+                for(size_t i = starts[b]; i < starts[b + 1]; ++i){
+                    for(int32_t u : uses[i]) if(written[u] != b) gen[b].push_back(u);
+                    if(defs[i] >= 0 && written[defs[i]] != b){
+                        written[defs[i]] = b;
+                        kill[b].push_back(defs[i]);
+                    }
+                }
+                sort(gen[b].begin(), gen[b].end());
+                gen[b].erase(unique(gen[b].begin(), gen[b].end()), gen[b].end());
+                sort(kill[b].begin(), kill[b].end());
+            }
+
+            vector<vector<int32_t>> live_in(blocks), live_out(blocks);
+            for(bool changed = true; changed; ){
+                changed = false;
+                for(size_t b = blocks; b-- > 0; ){
+                    const Instruction& in = f.code[starts[b + 1] - 1];
+                    vector<int32_t> out, live;
+                    auto merge = [&](size_t successor){
+                        vector<int32_t> merged;
+                        set_union(out.begin(), out.end(), live_in[successor].begin(), live_in[successor].end(), back_inserter(merged));
+                        out = std::move(merged);
+                    };
+                    if(in.op == Op::Jump) merge(block_of[in.imm]);
+                    else if(in.op == Op::JumpZero){ merge(b + 1); merge(block_of[in.imm]); }
+                    else if(in.op != Op::Return && b + 1 < blocks) merge(b + 1);
+
+                    vector<int32_t> through;
+                    set_difference(out.begin(), out.end(), kill[b].begin(), kill[b].end(), back_inserter(through));
+                    set_union(through.begin(), through.end(), gen[b].begin(), gen[b].end(), back_inserter(live));
+                    if(live != live_in[b] || out != live_out[b]){
+                        live_in[b] = std::move(live);
+                        live_out[b] = std::move(out);
+                        changed = true;
+                    }
+                }
+            }
+
+            // each register's range runs from the first to the last instruction it is live at, -1 is the prologue.
+            // within a block it is live from where it is seen, read or written, up to its next read, and out of
+            // the block after it is last seen if it is live out. it crosses a call live out of it that doesn't
+            // write it, any call between those but the write itself
+            vector<int64_t> first(f.registers, INT64_MAX), last(f.registers, -2);
+            vector<bool> crosses_call(f.registers);
+            auto extend = [&](size_t v, int64_t at){
+                first[v] = min(first[v], at);
+                last[v] = max(last[v], at);
+            };
+            vector<size_t> calls_before(n + 1);
+            for(size_t i = 0; i < n; ++i){
+                calls_before[i + 1] = calls_before[i] + is_call(f.code[i].op);
+            }
+            vector<size_t> seen(f.registers);      // where in its block it was last read or written
+            vector<bool> seen_written(f.registers);
+            auto live_until = [&](size_t v, size_t end){
+                size_t from = seen[v] + seen_written[v];
+                if(from < end && calls_before[end] > calls_before[from]){
+                    crosses_call[v] = true;
+                }
+            };
+            for(size_t b = 0; b < blocks; ++b){
+                for(int32_t v : live_in[b]){
+                    extend(v, starts[b]);
+                    seen[v] = starts[b], seen_written[v] = false;
+                }
+                for(size_t i = starts[b]; i < starts[b + 1]; ++i){
+                    for(int32_t u : uses[i]){
+                        extend(u, i);
+                        live_until(u, i);
+                        seen[u] = i, seen_written[u] = false;
+                    }
+                    if(defs[i] >= 0){
+                        extend(defs[i], i);
+                        seen[defs[i]] = i, seen_written[defs[i]] = true;
+                    }
+                }
+                for(int32_t v : live_out[b]){
+                    extend(v, starts[b + 1] - 1);
+                    live_until(v, starts[b + 1]);
+                }
+            }
+            if(blocks){
+                for(int32_t v : live_in[0]){
+                    first[v] = -1;
+                }
+            }
+
+            vector<size_t> order;
+            for(size_t v = 0; v < f.registers; ++v){
+                if(last[v] >= -1) order.push_back(v);
+            }
+            sort(order.begin(), order.end(), [&](size_t a, size_t b){ return first[a] < first[b]; });
+
+            where.assign(f.registers, Location{});
+            vector<size_t> active;
+            vector<bool> taken(16);
+            int32_t slots = 0;
+            auto spill = [&](size_t v){
+                where[v] = Location{-1, -32 - 8 * slots++};
+            };
+            for(size_t v : order){
+                // a range ending where this one starts is read before this one is written
+                erase_if(active, [&](size_t a){
+                    if(last[a] > first[v]) return false;
+                    taken[where[a].reg] = false;
+                    return true;
+                });
+
+                int reg = -1;
+                if(!crosses_call[v]){
+                    for(Reg r : caller_saved) if(reg < 0 && !taken[r]) reg = r;
+                }
+                for(Reg r : callee_saved) if(reg < 0 && !taken[r]) reg = r;
+
+                if(reg < 0){ // spill whichever ends last, if it can give this one its register
+                    auto allowed = [&](size_t a){
+                        return !crosses_call[v] || find(begin(callee_saved), end(callee_saved), where[a].reg) != end(callee_saved);
+                    };
+                    size_t victim = SIZE_MAX;
+                    for(size_t a : active){
+                        if(allowed(a) && (victim == SIZE_MAX || last[a] > last[victim])) victim = a;
+                    }
+                    if(victim == SIZE_MAX || last[victim] <= last[v]){
+                        spill(v);
+                        continue;
+                    }
+                    reg = where[victim].reg;
+                    spill(victim);
+                    erase(active, victim);
+                }
+                where[v] = Location{reg};
+                taken[reg] = true;
+                active.push_back(v);
+            }
+            for(size_t v : order){
+                where[v].at_entry = first[v] == -1;
+            }
+            return slots;
+        }
+
+        void compile(const Compiled& f){
+            int32_t slots = allocate(f);
+
+            // prologue: rbx, r12 and r13 are saved below rbp, then the spill slots, keeping rsp 16 byte aligned
+            push(RBP);
+            rr({0x89}, RSP, RBP, true);
+            for(Reg r : callee_saved) push(r);
+            alu_imm(5, RSP, 8 * slots + (slots % 2 ? 0 : 8), true);
+            if(f.frame_bytes){
+                alu_imm(0, R14, f.frame_bytes);
+            }
+            for(unsigned long v = 0; v < f.locals; ++v){
+                if(!where[v].at_entry){
+                    continue;   // its location may still belong to another range
+                }
+                if(v < f.parameters){
+                    rm({0x8B}, RAX, RBP, -1, 0, 16 + 8 * v);
+                }
+                else{
+                    rr({0x31}, RAX, RAX);
+                }
+                store(v, RAX);
+            }
+
+            vector<size_t> at(f.code.size() + 1);
+            vector<pair<size_t, size_t>> jumps;     // rel32 to patch, instruction jumped to
+            for(size_t i = 0; i < f.code.size(); ++i){
+                at[i] = code.size();
+                const Instruction& in = f.code[i];
+                switch(in.op){
+                    case Op::Const:
+                        mov_imm(RAX, in.imm);
+                        store(in.a, RAX);
+                        break;
+                    case Op::Move:
+                        load(RAX, in.b);
+                        store(in.a, RAX);
+                        break;
+                    case Op::AddImm:
+                        load(RAX, in.b);
+                        alu_imm(0, RAX, in.imm);
+                        store(in.a, RAX);
+                        break;
+                    case Op::Add: case Op::Sub: case Op::And: case Op::Or: case Op::Xor: case Op::Mul: {
+                        static const unordered_map<Op, uint8_t> opcodes{
+                            {Op::Add, 0x01}, {Op::Sub, 0x29}, {Op::And, 0x21}, {Op::Or, 0x09}, {Op::Xor, 0x31},
+                        };
+                        load(RAX, in.b);
+                        load(RCX, in.c);
+                        if(in.op == Op::Mul) rr({0x0F, 0xAF}, RAX, RCX);
+                        else rr({opcodes.at(in.op)}, RCX, RAX);
+                        store(in.a, RAX);
+                        break;
+                    }
+                    case Op::Shl: case Op::Shr:     // the count in cl is masked to 5 bits like wasm's
+                        load(RAX, in.b);
+                        load(RCX, in.c);
+                        rr({0xD3}, in.op == Op::Shl ? 4 : 7, RAX);
+                        store(in.a, RAX);
+                        break;
+                    case Op::Div: case Op::Rem: {
+                        load(RAX, in.b);
+                        load(RCX, in.c);
+                        rr({0x85}, RCX, RCX);
+                        jump_to_trap(E, DIVIDE_BY_ZERO);
+                        alu_imm(7, RCX, -1);
+                        size_t divide = jump_if(NE);
+                        size_t done = 0;
+                        if(in.op == Op::Div){ // INT_MIN / -1 traps, anything else / -1 negates
+                            alu_imm(7, RAX, INT32_MIN);
+                            jump_to_trap(E, UNREPRESENTABLE);
+                            rr({0xF7}, 3, RAX);
+                        }
+                        else{ // x % -1 is 0, idiv would fault on INT_MIN
+                            rr({0x31}, RDX, RDX);
+                        }
+                        done = jump();
+                        patch(divide, code.size());
+                        byte(0x99);
+                        rr({0xF7}, 7, RCX);
+                        patch(done, code.size());
+                        store(in.a, in.op == Op::Div ? RAX : RDX);
+                        break;
+                    }
+                    case Op::Lt: case Op::Gt: case Op::Le: case Op::Ge: case Op::Eq: case Op::Ne: {
+                        static const unordered_map<Op, Cond> conditions{
+                            {Op::Lt, L}, {Op::Gt, G}, {Op::Le, LE}, {Op::Ge, GE}, {Op::Eq, E}, {Op::Ne, NE},
+                        };
+                        load(RAX, in.b);
+                        load(RCX, in.c);
+                        rr({0x39}, RCX, RAX);
+                        rr({0x0F, (uint8_t)(0x90 + conditions.at(in.op))}, 0, RAX);
+                        rr({0x0F, 0xB6}, RAX, RAX);
+                        store(in.a, RAX);
+                        break;
+                    }
+                    case Op::Neg: case Op::Not:
+                        load(RAX, in.b);
+                        rr({0xF7}, in.op == Op::Neg ? 3 : 2, RAX);
+                        store(in.a, RAX);
+                        break;
+                    case Op::Eqz:
+                        load(RAX, in.b);
+                        rr({0x85}, RAX, RAX);
+                        rr({0x0F, 0x94}, 0, RAX);
+                        rr({0x0F, 0xB6}, RAX, RAX);
+                        store(in.a, RAX);
+                        break;
+                    case Op::Load: case Op::LoadAt:     // 32-bit operations zero the top of rax
+                        load(RAX, in.b);
+                        if(in.op == Op::Load){
+                            load(RCX, in.c);
+                            rm({0x8D}, RAX, RAX, RCX, 2, 0);
+                        }
+                        rm({0x8B}, RAX, R15, RAX, 0, in.imm);
+                        store(in.a, RAX);
+                        break;
+                    case Op::Store: case Op::StoreAt:
+                        load(RAX, in.a);
+                        if(in.op == Op::Store){
+                            load(RCX, in.b);
+                            rm({0x8D}, RAX, RAX, RCX, 2, 0);
+                        }
+                        load(RDX, in.c);
+                        rm({0x89}, RDX, R15, RAX, 0, in.imm);
+                        break;
+                    case Op::Check:
+                        load(RAX, in.a);
+                        alu_imm(7, RAX, in.imm);
+                        jump_to_trap(AE, UNREACHABLE);
+                        break;
+                    case Op::Array:
+                        mov(RAX, R14);
+                        alu_imm(5, RAX, in.imm);
+                        store(in.a, RAX);
+                        break;
+                    case Op::Jump:
+                        jumps.push_back({jump(), in.imm});
+                        break;
+                    case Op::JumpZero:
+                        load(RAX, in.a);
+                        rr({0x85}, RAX, RAX);
+                        jumps.push_back({jump_if(E), in.imm});
+                        break;
+                    case Op::Call: { // arguments on the stack, first at the lowest address, padded to keep rsp aligned
+                        unsigned long n = bytecode.functions[in.b].parameters, pushed = n + n % 2;
+                        if(n % 2){
+                            alu_imm(5, RSP, 8, true);
+                        }
+                        for(unsigned long k = n; k-- > 0; ){
+                            load(RAX, in.c + k);
+                            push(RAX);
+                        }
+                        byte(0xE8);
+                        dword(0);
+                        calls.push_back({code.size() - 4, in.b});
+                        if(pushed){
+                            alu_imm(0, RSP, 8 * pushed, true);
+                        }
+                        store(in.a, RAX);
+                        break;
+                    }
+                    case Op::Print: case Op::Putch:
+                        load(RDI, in.b);
+                        call_absolute(in.op == Op::Print ? (const void*)&print : (const void*)&putch);
+                        store(in.a, RAX);
+                        break;
+                    case Op::Fill:
+                        load(RDI, in.a);
+                        if(in.b){
+                            alu_imm(0, RDI, in.b);
+                        }
+                        mov_imm(RSI, in.imm);
+                        call_absolute((const void*)&fill);
+                        break;
+                    case Op::Copy:
+                        load(RDI, in.a);
+                        mov_imm64(RSI, (uint64_t)&bytecode.strings[in.imm]);
+                        call_absolute((const void*)&copy);
+                        break;
+                    case Op::Puts:
+                        mov_imm64(RDI, (uint64_t)&bytecode.strings[in.imm]);
+                        call_absolute((const void*)&puts_string);
+                        store(in.a, RAX);
+                        break;
+                    case Op::Return:
+                        load(RAX, in.a);
+                        if(f.frame_bytes){
+                            alu_imm(5, R14, f.frame_bytes);
+                        }
+                        rm({0x8D}, RSP, RBP, -1, 0, -24, true);
+                        for(auto it = rbegin(callee_saved); it != rend(callee_saved); ++it) pop(*it);
+                        pop(RBP);
+                        byte(0xC3);
+                        break;
+                }
+            }
+            at[f.code.size()] = code.size();
+            for(auto [rel, target] : jumps){
+                patch(rel, at[target]);
+            }
+        }
+};
+
+#else
+
+struct Jit {
+    Jit(Program&, bool = false){
+        cerr << "--jit only generates x86-64 code\n";
+        exit(EXIT_FAILURE);
+    }
+
+    int32_t run(){ return 0; }
+};
+
+#endif
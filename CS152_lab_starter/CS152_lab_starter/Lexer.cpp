@@ -1,9 +1,23 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <cstdlib>
 
 using namespace std;
 
+
+// after a compile error is printed this ends the process. a --batch worker sets throw_compile_errors
+// and gets a CompileError instead, so only its file fails while the other threads finish theirs
+struct CompileError {};
+inline thread_local bool throw_compile_errors = false;
+
+[[noreturn]] inline void compile_error(){
+    if(throw_compile_errors){
+        throw CompileError{};
+    }
+    exit(EXIT_FAILURE);
+}
+
 struct Token {
     string type, value;    
     unsigned long line;   
@@ -25,11 +39,25 @@ struct Lexer {
 
         while(*it) {tokens.push_back(next()); }
         
-        //tokens.push_back(token("eof"));
+        if(tokens.empty() || tokens.back().type != "eof"){ // source didn't end in whitespace
+            tokens.push_back(token("eof"));
+        }
 
         return tokens; 
     }
 
+    // up to count tokens at a time, so what follows can start before the whole source is lexed. the
+    // last batch ends in eof, after it they are empty
+    vector<Token> operator()(unsigned long count){
+        vector<Token> tokens;
+        while(!ended && tokens.size() < count){
+            tokens.push_back(*it ? next() : token("eof"));
+            ended = tokens.back().type == "eof";
+        }
+        return tokens;
+    }
+    bool ended = false;
+
     Token token(string type, string value = ""){  
         return {std::move(type), std::move(value), line}; 
     }   
@@ -61,6 +89,49 @@ struct Lexer {
         return next();
     }  
 
+    // "..." with the escapes \n \t \r \0 \\ \" and \xHH, every other byte, newlines too, stands for itself
+    Token string_literal(){
+        Token t = token("str");
+        ++it;
+        while(*it != '"'){
+            if(0 == *it){
+                cerr << "string starting on line " << t.line << " never ends\n";
+                compile_error();
+            }
+            if('\n' == *it){
+                line += 1;
+            }
+            if(*it != '\\'){
+                t.value += *it++;
+                continue;
+            }
+            ++it;
+            switch(*it++){
+                case 'n': t.value += '\n'; break;
+                case 't': t.value += '\t'; break;
+                case 'r': t.value += '\r'; break;
+                case '0': t.value += '\0'; break;
+                case '\\': t.value += '\\'; break;
+                case '"': t.value += '"'; break;
+                case 'x': {
+                    auto hex = [](char ch) { return ch >= '0' && ch <= '9' ? ch - '0' : ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 : ch >= 'A' && ch <= 'F' ? ch - 'A' + 10 : -1; };
+                    if(hex(it[0]) < 0 || hex(it[1]) < 0){
+                        cerr << "\\x on line " << line << " wants two hex digits\n";
+                        compile_error();
+                    }
+                    t.value += (char)(hex(it[0]) * 16 + hex(it[1]));
+                    it += 2;
+                    break;
+                }
+                default:
+                    cerr << "unknown escape \\" << it[-1] << " on line " << line << "\n";
+                    compile_error();
+            }
+        }
+        ++it;
+        return t;
+    }
+
     bool is_digit(){    
         return *it >= '0' && *it <= '9';   
     }
@@ -94,6 +165,10 @@ struct Lexer {
             } 
         }
 
+        if(*it == '"'){
+            return string_literal();
+        }
+
         if(is_digit()) {    
             string value = "";
             while(is_digit()) {
@@ -121,7 +196,7 @@ struct Lexer {
             return token("eof");
         }
         cerr << "lexer hit invalid charcter " << *it << "\n"; 
-        exit(1);       
+        compile_error();       
     }                 
 
 };
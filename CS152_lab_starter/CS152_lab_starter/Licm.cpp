@@ -0,0 +1,255 @@
+#include <vector>
+#include <string>
+#include <optional>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+
+// loop-invariant code motion. expressions in a loop body that can't change between iterations are
+// computed once into a fresh local declared just before the loop. hoisted code may run when the
+// original wouldn't have (behind an if, after a break), so only pure expressions that can't trap move:
+// no calls, no division by a possibly zero divisor, and only loads from local arrays at a constant
+// in-bounds index. local arrays never overlap each other or anything an array parameter points to,
+// so only a store to the array itself or handing it to a call keeps its loads in the loop. a store
+// through one of strength reduction's pointers is a store to the array it was made from, or to any
+// array when that isn't known
+struct Licm {
+    unsigned long hoisted = 0;
+
+    Licm(Program& program){
+        for(auto& f : program.functions){
+            counter = 0;
+            scopes = {{}};
+            for(auto& p : f.parameters){
+                scopes.back()[p.name] = Variable{p.is_array(), {}};
+            }
+            optimize(f.body);
+        }
+    }
+
+    private:
+        struct Variable {
+            bool is_array;
+            optional<long long> array_size;    // empty for array parameters
+            bool pointer = false;
+            optional<string> points_into;      // the array a pointer was set from
+        };
+
+        // what a single loop body changes
+        struct Effects {
+            unordered_set<string> assigned, declared, stored;
+            bool stored_anywhere = false;      // through a pointer into no known array
+        };
+
+        vector<unordered_map<string, Variable>> scopes;
+        unsigned long counter;
+
+        Variable *lookup(const string& name){
+            for(auto it = scopes.rbegin(); it != scopes.rend(); ++it){
+                if(it->contains(name)){
+                    return &(*it)[name];
+                }
+            }
+            return nullptr;
+        }
+
+        void optimize(Block& b){
+            scopes.push_back({});
+            for(unsigned long i = 0; i < b.body.size(); ++i){
+                walk_inlined(b.body[i], [&](InlinedCall& call){ optimize(call); });
+                if(auto *let = get_if<Let>(&b.body[i])){
+                    for(auto& dec : let->declarations){
+                        optional<long long> size;
+                        if(dec.array_size){
+                            size = stoll(*dec.array_size);
+                        }
+                        scopes.back()[dec.name] = Variable{dec.array_size.has_value(), size, dec.pointer};
+                    }
+                }
+                else if(auto *assign = get_if<Assign>(&b.body[i])){
+                    auto *var = get_if<VariableAccess>(&assign->lhs);
+                    if(Variable *v = var ? lookup(var->name) : nullptr; v && v->pointer){
+                        v->points_into = origin(assign->rhs, {});
+                    }
+                }
+                else if(auto *block = get_if<Block>(&b.body[i])){
+                    optimize(*block);
+                }
+                else if(auto *branch = get_if<If>(&b.body[i])){
+                    optimize(branch->if_body);
+                    optimize(branch->else_body);
+                }
+                else if(auto *loop = get_if<Loop>(&b.body[i])){
+                    optimize(loop->body);   // inner loops first, their preheaders may hoist further out
+                    vector<Stmt> preheader = hoist(*loop);
+                    b.body.insert(b.body.begin() + i, make_move_iterator(preheader.begin()), make_move_iterator(preheader.end()));
+                    i += preheader.size();
+                }
+            }
+            scopes.pop_back();
+        }
+
+        // an inlined body sees only the callee's parameters. the counter carries on, its locals share the
+        // caller's frame
+        void optimize(InlinedCall& call){
+            auto outer = std::move(scopes);
+            scopes = {{}};
+            for(auto& p : call.parameters){
+                scopes.back()[p.name] = Variable{p.is_array(), {}};
+            }
+            optimize(call.body);
+            scopes = std::move(outer);
+        }
+
+        // the array p = a + ... points into, when a is an array or a pointer with a known one
+        optional<string> origin(Expr& rhs, const unordered_map<string, optional<string>>& local_pointers){
+            auto *binop = get_if<BinaryOperation>(&rhs);
+            auto *base = binop && binop->opcode == "+" ? get_if<VariableAccess>(&binop->args[0]) : nullptr;
+            if(!base){
+                return {};
+            }
+            if(local_pointers.contains(base->name)){
+                return local_pointers.at(base->name);
+            }
+            Variable *v = lookup(base->name);
+            return !v ? nullopt : v->pointer ? v->points_into : v->is_array ? optional<string>{base->name} : nullopt;
+        }
+
+        Effects effects(Block& body){
+            Effects fx;
+            unordered_map<string, optional<string>> local_pointers;   // declared in the body, set before its loops
+            vector<string> stores;
+            walk_statements(body, [&](Stmt& s){
+                if(auto *let = get_if<Let>(&s)){
+                    for(auto& dec : let->declarations){
+                        fx.declared.insert(dec.name);
+                        if(dec.pointer){
+                            local_pointers[dec.name] = {};
+                        }
+                    }
+                }
+                else if(auto *assign = get_if<Assign>(&s)){
+                    if(auto *var = get_if<VariableAccess>(&assign->lhs)){
+                        fx.assigned.insert(var->name);
+                        if(auto p = local_pointers.find(var->name); p != local_pointers.end() && !p->second){
+                            p->second = origin(assign->rhs, local_pointers);
+                        }
+                    }
+                    else if(auto *aa = get_if<ArrayAccess>(&assign->lhs)){
+                        stores.push_back(aa->name);
+                    }
+                }
+            });
+            for(auto& name : stores){
+                Variable *v = local_pointers.contains(name) ? nullptr : lookup(name);
+                bool pointer = local_pointers.contains(name) || v && v->pointer;
+                optional<string> into = !pointer ? optional<string>{name}
+                                      : local_pointers.contains(name) ? local_pointers[name] : v->points_into;
+                if(into){
+                    fx.stored.insert(*into);
+                }
+                else{
+                    fx.stored_anywhere = true;
+                }
+            }
+            // an array handed to a call may be written by it
+            auto escape = [&](vector<Expr>& arguments){
+                for(auto& arg : arguments){
+                    if(auto *var = get_if<VariableAccess>(&arg)){
+                        fx.stored.insert(var->name);
+                    }
+                }
+            };
+            walk(body, [&](Expr& e){
+                if(auto *call = get_if<FunctionCall>(&e)){
+                    escape(call->arguments);
+                }
+                else if(auto *inlined = get_if<InlinedCall>(&e)){
+                    escape(inlined->arguments);
+                }
+            });
+            return fx;
+        }
+
+        // whether e is the same on every iteration, once its operands are
+        bool invariant(Expr& e, const Effects& fx){
+            if(holds_alternative<IntegerLiteral>(e) || holds_alternative<UnaryOperation>(e)){
+                return true;
+            }
+            if(auto *var = get_if<VariableAccess>(&e)){
+                return lookup(var->name) && !fx.declared.contains(var->name) && !fx.assigned.contains(var->name);
+            }
+            if(auto *binop = get_if<BinaryOperation>(&e)){
+                if(binop->opcode == "/" || binop->opcode == "%"){
+                    auto divisor = Folder::constant(binop->args[1]);
+                    return divisor && *divisor != 0 && *divisor != -1;
+                }
+                return true;
+            }
+            if(auto *aa = get_if<ArrayAccess>(&e)){
+                Variable *v = lookup(aa->name);
+                auto index = Folder::constant(aa->index[0]);
+                return v && v->array_size && index && *index >= 0 && *index < *v->array_size
+                    && !fx.declared.contains(aa->name) && !fx.stored.contains(aa->name) && !fx.stored_anywhere;
+            }
+            return false;
+        }
+
+        // replaces the largest invariant subexpressions of e, parents before children. which are invariant
+        // is worked out children first in one walk, not again for every parent, so nesting stays cheap
+        void hoist(Expr& root, const Effects& fx, vector<Stmt>& preheader){
+            unordered_set<Expr*> same;
+            walk(root, [&](Expr& e){
+                auto *operands = e.children();
+                bool all = !operands || all_of(operands->begin(), operands->end(), [&](Expr& o){ return same.contains(&o); });
+                if(all && invariant(e, fx)){
+                    same.insert(&e);
+                }
+            }, false);
+
+            vector<Expr*> stack{&root};
+            while(!stack.empty()){
+                Expr& e = *stack.back();
+                stack.pop_back();
+                bool trivial = holds_alternative<IntegerLiteral>(e) || holds_alternative<VariableAccess>(e);
+                if(!trivial && same.contains(&e)){
+                    string name = "licm." + to_string(counter++);
+                    preheader.push_back(Let{{VariableDeclarations{name, {}}}});
+                    preheader.push_back(Assign{VariableAccess{name}, std::move(e)});
+                    e = VariableAccess{name};
+                    ++hoisted;
+                }
+                else if(auto *operands = e.children()){ // an inlined body names the callee's variables
+                    for(auto it = operands->rbegin(); it != operands->rend(); ++it){
+                        stack.push_back(&*it);
+                    }
+                }
+            }
+        }
+
+        vector<Stmt> hoist(Loop& loop){
+            Effects fx = effects(loop.body);
+            vector<Stmt> preheader;
+            walk_statements(loop.body, [&](Stmt& s){
+                if(auto *expr = get_if<Expr>(&s)){
+                    hoist(*expr, fx, preheader);
+                }
+                else if(auto *ret = get_if<Return>(&s)){
+                    hoist(ret->return_value, fx, preheader);
+                }
+                else if(auto *branch = get_if<If>(&s)){
+                    hoist(branch->cond, fx, preheader);
+                }
+                else if(auto *assign = get_if<Assign>(&s)){
+                    if(auto *aa = get_if<ArrayAccess>(&assign->lhs)){
+                        hoist(aa->index[0], fx, preheader);
+                    }
+                    hoist(assign->rhs, fx, preheader);
+                }
+            });
+            return preheader;
+        }
+};
@@ -0,0 +1,127 @@
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+
+// the scoping errors Codegen finds as it resolves names, found before any pass can drop code. folding
+// if 0 { ... } or specializing a function away would take its errors with it, and then whether a
+// program compiled would be up to the -O level. same scopes and messages as Codegen's symbol table
+struct Names {
+    Names(Program& program){
+        for(auto& f : program.functions){
+            scopes = {{}};
+            for(auto& p : f.parameters){
+                if(scopes.back().contains(p.name)){
+                    cerr << "Attempted redeclaration of parameter " << p.name << "\n";
+                    compile_error();
+                }
+                scopes.back()[p.name] = {p.is_array()};
+            }
+            loop_depth = 0;
+            check(f.body);
+        }
+    }
+
+    private:
+        struct Symbol {
+            bool is_array, is_pointer = false;
+        };
+
+        vector<unordered_map<string, Symbol>> scopes;
+        unsigned long loop_depth;
+
+        Symbol& lookup(const string& name){
+            for(auto it = scopes.rbegin(); it != scopes.rend(); ++it){
+                if(it->contains(name)){
+                    return (*it)[name];
+                }
+            }
+            cerr << "oh we looked up " << name << " but never found a symbol for it\n";
+            compile_error();
+        }
+
+        void check(Expr& e){
+            walk(e, [&](Expr& e){
+                if(auto *var = get_if<VariableAccess>(&e)){
+                    lookup(var->name);
+                }
+                else if(auto *aa = get_if<ArrayAccess>(&e); aa && !lookup(aa->name).is_array){
+                    cerr << "Old C stuff, denied :(\n";
+                    compile_error();
+                }
+            }, false);
+        }
+
+        void check(Block& b){
+            scopes.push_back({});
+            for(auto& s : b.body){
+                check(s);
+            }
+            scopes.pop_back();
+        }
+
+        void check(Stmt& s){
+            if(auto *expr = get_if<Expr>(&s)){
+                check(*expr);
+            }
+            else if(auto *let = get_if<Let>(&s)){
+                for(auto& dec : let->declarations){
+                    if(scopes.back().contains(dec.name)){
+                        cerr << "Attempted redeclaration of " << dec.name << "\n";
+                        compile_error();
+                    }
+                    scopes.back()[dec.name] = {dec.array_size || dec.pointer, dec.pointer};
+                    if(dec.initializer){
+                        for(auto& element : *dec.initializer){
+                            check(element);
+                        }
+                    }
+                }
+            }
+            else if(auto *block = get_if<Block>(&s)){
+                check(*block);
+            }
+            else if(auto *ret = get_if<Return>(&s)){
+                check(ret->return_value);
+            }
+            else if(auto *loop = get_if<Loop>(&s)){
+                ++loop_depth;
+                check(loop->body);
+                --loop_depth;
+            }
+            else if(holds_alternative<Break>(s) || holds_alternative<Continue>(s)){
+                if(!loop_depth){
+                    cerr << "break or continue outside of a loop\n";
+                    compile_error();
+                }
+            }
+            else if(auto *branch = get_if<If>(&s)){
+                check(branch->cond);
+                check(branch->if_body);
+                check(branch->else_body);
+            }
+            else if(auto *assign = get_if<Assign>(&s)){
+                if(auto *var = get_if<VariableAccess>(&assign->lhs)){
+                    Symbol& symbol = lookup(var->name);
+                    if(symbol.is_array && !symbol.is_pointer){
+                        cerr << "Attempted assignment to array like it was a variable\n";
+                        compile_error();
+                    }
+                }
+                else if(auto *aa = get_if<ArrayAccess>(&assign->lhs)){
+                    if(!lookup(aa->name).is_array){
+                        cerr << "Attempted assignment to variable like it was an array\n";
+                        compile_error();
+                    }
+                    check(aa->index[0]);
+                }
+                else{
+                    cerr << "Tried to assign to an expression that isn't assignable\n";
+                    compile_error();
+                }
+                check(assign->rhs);
+            }
+        }
+};
@@ -0,0 +1,116 @@
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <optional>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+
+// runs work(0), ..., work(count - 1) on up to jobs threads, the calling one among them. the indices
+// are handed out one at a time, so one big function doesn't leave the other threads waiting on it.
+// work writes its result to its own slot, which keeps the output in order whatever ran first
+void parallel_for(unsigned long count, unsigned long jobs, const function<void(unsigned long)>& work){
+    atomic<unsigned long> next = 0;
+    auto worker = [&]{
+        for(unsigned long i; (i = next++) < count; ){
+            work(i);
+        }
+    };
+
+    vector<thread> threads;
+    for(unsigned long t = 1; t < min(jobs, count); ++t){
+        threads.emplace_back(worker);
+    }
+    worker();
+    for(auto& t : threads){
+        t.join();
+    }
+}
+
+
+// parallel_for for many independent jobs, like the files of a batch. each thread has its own queue,
+// the indices dealt out round robin, and works through it from the back. a thread whose queue is
+// empty steals from the front of another's, so threads only meet on a lock when one runs dry
+void stealing_for(unsigned long count, unsigned long jobs, const function<void(unsigned long)>& work){
+    jobs = max(1ul, min(jobs, count));
+    struct Queue {
+        mutex lock;
+        deque<unsigned long> work;
+    };
+    vector<Queue> queues(jobs);
+    for(unsigned long i = 0; i < count; ++i){
+        queues[i % jobs].work.push_front(i);    // so each thread starts with its lowest index
+    }
+
+    auto worker = [&](unsigned long self){
+        while(true){
+            optional<unsigned long> next;
+            {
+                lock_guard guard{queues[self].lock};
+                if(!queues[self].work.empty()){
+                    next = queues[self].work.back();
+                    queues[self].work.pop_back();
+                }
+            }
+            for(unsigned long k = 1; !next && k < jobs; ++k){
+                Queue& victim = queues[(self + k) % jobs];
+                lock_guard guard{victim.lock};
+                if(!victim.work.empty()){
+                    next = victim.work.front();
+                    victim.work.pop_front();
+                }
+            }
+            if(!next){ // nothing is ever added, so every queue being empty means all work is taken
+                return;
+            }
+            work(*next);
+        }
+    };
+
+    vector<thread> threads;
+    for(unsigned long t = 1; t < jobs; ++t){
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for(auto& t : threads){
+        t.join();
+    }
+}
+
+
+// a bounded queue from exactly one thread to exactly one other. head is only written by the
+// consumer and tail by the producer, and both only grow, so there is no lock: a side that has to
+// wait sleeps on the other side's counter until it moves
+template<class T>
+struct Channel {
+    Channel(unsigned long capacity = 64) : slots(capacity) {}
+
+    void push(T value){
+        unsigned long t = tail.load(memory_order_relaxed);
+        for(unsigned long h; t - (h = head.load(memory_order_acquire)) == slots.size(); ){ // full
+            head.wait(h, memory_order_acquire);
+        }
+        slots[t % slots.size()] = std::move(value);
+        tail.store(t + 1, memory_order_release);
+        tail.notify_one();
+    }
+
+    T pop(){
+        unsigned long h = head.load(memory_order_relaxed);
+        while(tail.load(memory_order_acquire) == h){ // empty
+            tail.wait(h, memory_order_acquire);
+        }
+        T value = std::move(slots[h % slots.size()]);
+        head.store(h + 1, memory_order_release);
+        head.notify_one();
+        return value;
+    }
+
+    private:
+        vector<T> slots;
+        atomic<unsigned long> head = 0, tail = 0;
+};
@@ -0,0 +1,222 @@
+#include <vector>
+#include <string>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <functional>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+
+// --serve, a compiler that stays up so a compile doesn't pay for starting a process. requests and
+// responses are framed the same on stdin/stdout or on each connection to a unix socket
+//     request:   <source bytes> [flag ...]\n<source>
+//     response:  <exit status> <output bytes> <diagnostic bytes>\n<output><diagnostics>
+// a request can be sent before the last one is answered, answers come back in the order asked. the
+// compiler stops at the first error with exit(), so each request is compiled in a child forked off
+// the warm server, which also keeps one bad program from taking the server down. up to jobs children
+// run at once for each connection
+struct Server {
+    using Compile = function<void(const string& source, const vector<string>& flags)>;
+
+    Server(unsigned long jobs, Compile compile) : jobs(jobs), compile(std::move(compile)) {
+        signal(SIGPIPE, SIG_IGN);   // a client that hangs up is noticed when writing to it fails
+    }
+
+    // answers requests from in on out until in ends, or a request is malformed
+    void serve(int in, int out){
+        this->in = in;
+        this->out = out;
+        buffered.clear();
+
+        string source;
+        vector<string> flags;
+        while(request(source, flags)){
+            if(pending.size() == jobs){
+                respond();
+            }
+            pending.push_back(start(source, flags));
+        }
+        while(!pending.empty()){
+            respond();
+        }
+    }
+
+    // serves connections on a unix socket at path, each in a process of its own forked off the warm
+    // server, so a slow or stalled client doesn't hold up the others. up to connections are served at
+    // once, and one that sends nothing for idle_seconds is closed
+    void listen(const string& path){
+        int server = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if(server < 0 || path.size() >= sizeof address.sun_path){
+            cerr << "couldn't open a socket at " << path << "\n";
+            exit(EXIT_FAILURE);
+        }
+        strcpy(address.sun_path, path.c_str());
+        unlink(path.c_str());
+        if(bind(server, (sockaddr*)&address, sizeof address) < 0 || ::listen(server, 16) < 0){
+            cerr << "couldn't listen on " << path << ": " << strerror(errno) << "\n";
+            exit(EXIT_FAILURE);
+        }
+        unsigned long open = 0;
+        while(true){
+            while(open && waitpid(-1, nullptr, open == connections ? 0 : WNOHANG) > 0){ // the ones done
+                --open;
+            }
+            int connection = accept(server, nullptr, nullptr);
+            if(connection < 0){
+                continue;
+            }
+            timeval idle{idle_seconds, 0};
+            setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof idle);  // then read fails, ending it
+            cout.flush();
+            cerr.flush();
+            pid_t child = fork();
+            if(child == 0){
+                close(server);
+                serve(connection, connection);
+                _exit(EXIT_SUCCESS);
+            }
+            if(child < 0){
+                cerr << "couldn't fork a connection\n";
+            }
+            else{
+                ++open;
+            }
+            close(connection);
+        }
+    }
+
+    private:
+        struct Pending {
+            pid_t child;
+            FILE *output, *diagnostics;
+        };
+
+        static constexpr unsigned long connections = 64;
+        static constexpr long idle_seconds = 60;
+
+        unsigned long jobs;
+        Compile compile;
+        int in, out;
+        string buffered;        // read from in but not used yet
+        deque<Pending> pending; // oldest first, the order they are answered in
+
+        // reads until buffered holds n bytes, false if in ended first
+        bool fill(unsigned long n){
+            char chunk[1 << 16];
+            while(buffered.size() < n){
+                pollfd ready{in, POLLIN, 0};
+                while(!pending.empty() && poll(&ready, 1, 0) == 0){ // no more requests yet, answer the ones running
+                    respond();
+                }
+                ssize_t got = read(in, chunk, sizeof chunk);
+                if(got < 0 && errno == EINTR){
+                    continue;
+                }
+                if(got <= 0){
+                    return false;
+                }
+                buffered.append(chunk, got);
+            }
+            return true;
+        }
+
+        bool request(string& source, vector<string>& flags){
+            unsigned long newline;
+            while((newline = buffered.find('\n')) == string::npos){
+                if(!fill(buffered.size() + 1)){
+                    return false;
+                }
+            }
+            istringstream header{buffered.substr(0, newline)};
+            buffered.erase(0, newline + 1);
+
+            unsigned long length;
+            if(!(header >> length)){
+                cerr << "a request has to start with the length of its source\n";
+                return false;
+            }
+            flags.clear();
+            for(string flag; header >> flag; ){
+                flags.push_back(flag);
+            }
+            if(!fill(length)){
+                cerr << "the last request ended in the middle of its source\n";
+                return false;
+            }
+            source = buffered.substr(0, length);
+            buffered.erase(0, length);
+            return true;
+        }
+
+        // the child writes to files it shares with the server rather than to pipes, so it never
+        // blocks on a server that is still waiting on an earlier child
+        Pending start(const string& source, const vector<string>& flags){
+            Pending p{-1, tmpfile(), tmpfile()};
+            if(!p.output || !p.diagnostics){
+                cerr << "couldn't make files for a compile's output\n";
+                exit(EXIT_FAILURE);
+            }
+            cout.flush();
+            cerr.flush();
+            p.child = fork();
+            if(p.child < 0){
+                cerr << "couldn't fork a compile\n";
+                exit(EXIT_FAILURE);
+            }
+            if(p.child == 0){
+                dup2(fileno(p.output), STDOUT_FILENO);
+                dup2(fileno(p.diagnostics), STDERR_FILENO);
+                compile(source, flags);
+                cout.flush();
+                cerr.flush();
+                _exit(EXIT_SUCCESS);
+            }
+            return p;
+        }
+
+        void respond(){
+            Pending p = pending.front();
+            pending.pop_front();
+            int status;
+            while(waitpid(p.child, &status, 0) < 0 && errno == EINTR){}
+            int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+            string output = contents(p.output), diagnostics = contents(p.diagnostics);
+            string response = to_string(code) + " " + to_string(output.size()) + " " + to_string(diagnostics.size()) + "\n"
+                            + output + diagnostics;
+            for(unsigned long sent = 0; sent < response.size(); ){
+                ssize_t wrote = write(out, response.data() + sent, response.size() - sent);
+                if(wrote < 0 && errno == EINTR){
+                    continue;
+                }
+                if(wrote <= 0){     // the client went away
+                    return;
+                }
+                sent += wrote;
+            }
+        }
+
+        static string contents(FILE *file){
+            string bytes;
+            char chunk[1 << 16];
+            rewind(file);
+            for(size_t got; (got = fread(chunk, 1, sizeof chunk, file)) > 0; ){
+                bytes.append(chunk, got);
+            }
+            fclose(file);
+            return bytes;
+        }
+};
@@ -0,0 +1,125 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+
+// clones a callee for each distinct set of constant arguments it is called with,
+// substitutes the constants into the clone and folds it. the clone for f(x, 8) is named $f._.8
+// and has the constant parameters removed, so the call becomes f._.8(x)
+struct Specializer {
+    stringstream report;
+
+    Specializer(Program& program, unsigned long limit) : limit(limit) {
+        for(unsigned long i = 0; i < program.functions.size(); ++i){
+            generic[program.functions[i].name] = i;
+        }
+
+        for(unsigned long i = 0; i < program.functions.size(); ++i){ // clones are appended, so they get scanned too
+            vector<Function> created;
+            walk(program.functions[i].body, [&](Expr& e){
+                if(auto *call = get_if<FunctionCall>(&e)){
+                    specialize(program, *call, created);
+                }
+            });
+            for(auto& clone : created){
+                program.functions.push_back(std::move(clone));
+            }
+        }
+
+        remove_dead(program);
+    }
+
+    private:
+        unsigned long limit;
+        unordered_map<string, unsigned long> generic;   // index into program.functions
+        unordered_map<string, unordered_set<string>> clones;
+
+        void specialize(Program& program, FunctionCall& call, vector<Function>& created){
+            if(!generic.contains(call.name) || call.name == "main"){
+                return;
+            }
+            Function& f = program.functions[generic[call.name]];
+            if(f.parameters.size() != call.arguments.size()){
+                return;
+            }
+
+            string name = f.name;
+            bool any = false;
+            vector<optional<int32_t>> values;
+            for(unsigned long i = 0; i < f.parameters.size(); ++i){
+                auto value = Folder::constant(call.arguments[i]);
+                if(value && !Folder::substitutable(f.body, f.parameters[i])){
+                    value.reset();
+                }
+                values.push_back(value);
+                name += "." + (value ? to_string(*value) : string("_"));
+                any = any || value;
+            }
+            if(!any){
+                return;
+            }
+
+            auto& existing = clones[f.name];
+            if(!existing.contains(name)){
+                if(existing.size() >= limit){
+                    report << "kept call to " << f.name << " as " << name << ", limit of " << limit << " clones reached\n";
+                    return;
+                }
+                existing.insert(name);
+                created.push_back(clone(f, name, values));
+                report << "specialized " << f.name << " as " << name << "\n";
+            }
+
+            call.name = name;
+            vector<Expr> arguments;
+            for(unsigned long i = 0; i < values.size(); ++i){
+                if(!values[i]){
+                    arguments.push_back(std::move(call.arguments[i]));
+                }
+            }
+            call.arguments = std::move(arguments);
+        }
+
+        static Function clone(Function& f, const string& name, const vector<optional<int32_t>>& values){
+            Function c;
+            c.name = name;
+            c.body = f.body;
+
+            for(unsigned long i = 0; i < values.size(); ++i){
+                if(values[i]){
+                    Folder::substitute(c.body, f.parameters[i].name, *values[i]);
+                }
+                else{
+                    c.parameters.push_back(f.parameters[i]);
+                }
+            }
+            Folder{c};
+            return c;
+        }
+
+        // a generic function every call of which now goes to a clone
+        void remove_dead(Program& program){
+            unordered_set<string> live{"main"};
+            for(auto& f : program.functions){
+                walk(f.body, [&](Expr& e){
+                    if(auto *call = get_if<FunctionCall>(&e)){
+                        live.insert(call->name);
+                    }
+                });
+            }
+            vector<Function> kept;
+            for(auto& f : program.functions){
+                if(clones.contains(f.name) && !live.contains(f.name)){
+                    report << "removed " << f.name << ", every call was specialized\n";
+                    continue;
+                }
+                kept.push_back(std::move(f));
+            }
+            program.functions = std::move(kept);
+        }
+};
@@ -0,0 +1,155 @@
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <ctime>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include <sys/resource.h>
+
+using namespace std;
+
+
+// every allocation the compiler makes goes through here, and is counted while something measures
+// them, like --time-report. otherwise it's one relaxed load, not two shared adds every threads' new
+// fights over. kept out of line, or g++ sees new paired with free and warns
+inline atomic<unsigned long> allocations = 0, allocated_bytes = 0;
+inline atomic<int> counting = 0;   // how many CountAllocations are alive
+
+[[gnu::noinline]] void *operator new(size_t size){
+    if(counting.load(memory_order_relaxed)){
+        allocations.fetch_add(1, memory_order_relaxed);
+        allocated_bytes.fetch_add(size, memory_order_relaxed);
+    }
+    if(void *p = malloc(size ? size : 1)){
+        return p;
+    }
+    throw bad_alloc{};
+}
+[[gnu::noinline]] void operator delete(void *p) noexcept {
+    free(p);
+}
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+// allocations are counted while one of these is alive
+struct CountAllocations {
+    CountAllocations(){
+        counting.fetch_add(1, memory_order_relaxed);
+    }
+    ~CountAllocations(){
+        counting.fetch_sub(1, memory_order_relaxed);
+    }
+    CountAllocations(const CountAllocations&) = delete;
+    CountAllocations& operator=(const CountAllocations&) = delete;
+};
+
+
+// --time-report, where a compile spends its time and memory, phase by phase: lexing, parsing, each
+// pass, codegen and writing the output. a phase that runs more than once, like the passes for every
+// function with --stream, adds up under its name. --time-report=json prints the same for scripts
+struct TimeReport {
+    struct Phase {
+        string name;
+        double wall = 0, cpu = 0;   // seconds
+        unsigned long allocations = 0, bytes = 0;
+        long peak_rss = 0;          // KiB, the most the process had used by the phase's end
+    };
+    struct Function {
+        string name;
+        unsigned long instructions, locals;
+    };
+
+    vector<Phase> phases;
+    vector<pair<string, unsigned long>> counts;     // tokens, AST nodes, ...
+    vector<Function> functions;
+    CountAllocations counted;
+
+    template<class F>
+    void time(const string& name, F&& work){
+        auto wall = chrono::steady_clock::now();
+        clock_t cpu = clock();
+        unsigned long allocated = allocations, bytes = allocated_bytes;
+
+        work();
+
+        auto it = find_if(phases.begin(), phases.end(), [&](Phase& p){ return p.name == name; });
+        Phase& p = it == phases.end() ? phases.emplace_back(Phase{name}) : *it;
+        p.wall += chrono::duration<double>(chrono::steady_clock::now() - wall).count();
+        p.cpu += double(clock() - cpu) / CLOCKS_PER_SEC;
+        p.allocations += allocations - allocated;
+        p.bytes += allocated_bytes - bytes;
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        p.peak_rss = usage.ru_maxrss;
+    }
+
+    void count(const string& name, unsigned long n){
+        auto it = find_if(counts.begin(), counts.end(), [&](auto& c){ return c.first == name; });
+        if(it == counts.end()){
+            counts.push_back({name, n});
+        }
+        else{
+            it->second += n;
+        }
+    }
+
+    void print(ostream& out, bool json){
+        if(json){
+            out << "{\"phases\": [";
+            for(unsigned long i = 0; i < phases.size(); ++i){
+                Phase& p = phases[i];
+                out << (i ? ", " : "") << "{\"name\": \"" << p.name << "\", \"wall\": " << p.wall << ", \"cpu\": " << p.cpu
+                    << ", \"allocations\": " << p.allocations << ", \"bytes\": " << p.bytes << ", \"peak_rss_kib\": " << p.peak_rss << "}";
+            }
+            out << "], \"counts\": {";
+            for(unsigned long i = 0; i < counts.size(); ++i){
+                out << (i ? ", " : "") << "\"" << counts[i].first << "\": " << counts[i].second;
+            }
+            out << "}, \"functions\": [";
+            for(unsigned long i = 0; i < functions.size(); ++i){
+                out << (i ? ", " : "") << "{\"name\": \"" << functions[i].name << "\", \"instructions\": "
+                    << functions[i].instructions << ", \"locals\": " << functions[i].locals << "}";
+            }
+            out << "]}\n";
+            return;
+        }
+
+        Phase total{"total"};
+        out << left << setw(18) << "phase" << right << setw(11) << "wall ms" << setw(11) << "cpu ms"
+            << setw(14) << "allocations" << setw(14) << "bytes" << setw(14) << "peak RSS KiB" << "\n";
+        auto line = [&](Phase& p){
+            out << left << setw(18) << p.name << right << fixed << setprecision(3) << setw(11) << 1000 * p.wall
+                << setw(11) << 1000 * p.cpu << setw(14) << p.allocations << setw(14) << p.bytes << setw(14) << p.peak_rss << "\n";
+        };
+        for(auto& p : phases){
+            line(p);
+            total.wall += p.wall;
+            total.cpu += p.cpu;
+            total.allocations += p.allocations;
+            total.bytes += p.bytes;
+            total.peak_rss = max(total.peak_rss, p.peak_rss);
+        }
+        line(total);
+        out << defaultfloat << "\n";
+
+        for(auto& [name, n] : counts){
+            out << left << setw(18) << name << right << setw(11) << n << "\n";
+        }
+
+        // the biggest functions, all of them are in the json
+        auto biggest = functions;
+        sort(biggest.begin(), biggest.end(), [](Function& a, Function& b){ return a.instructions > b.instructions; });
+        biggest.resize(min(biggest.size(), 10ul));
+        if(!biggest.empty()){
+            out << "\n" << left << setw(18) << "function" << right << setw(14) << "instructions" << setw(11) << "locals" << "\n";
+        }
+        for(auto& f : biggest){
+            out << left << setw(18) << f.name << right << setw(14) << f.instructions << setw(11) << f.locals << "\n";
+        }
+    }
+};
@@ -1,13 +1,36 @@
 #include <vector>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <variant>
 #include <optional>
 #include <functional>
 #include <sstream>
+#include <fstream>
+#include <set>
+#include <chrono>
+#include <iomanip>
 
 #include "AST.cpp"
 #include "Lexer.cpp"
+#include "Names.cpp"
+#include "Folder.cpp"
+#include "Specializer.cpp"
+#include "Inliner.cpp"
+#include "BoundsCheck.cpp"
+#include "Vectorizer.cpp"
+#include "InductionVariables.cpp"
+#include "Licm.cpp"
+#include "Bytecode.cpp"
+#include "Interpreter.cpp"
+#include "Jit.cpp"
+#include "CBackend.cpp"
+#include "Cache.cpp"
+#include "Parallel.cpp"
+#include "Server.cpp"
+#include "Batch.cpp"
+#include "TimeReport.cpp"
+#include "Generator.cpp"
 
 using namespace std;
 
@@ -15,23 +38,81 @@ using namespace std;
 #include "webpage/boilerplate.hpp"
 
 
+// where each function's tokens begin and end. only functions are allowed at the top level, so matching
+// the braces finds them without parsing anything, what is malformed is left for the parser to report
+vector<pair<unsigned long, unsigned long>> function_ranges(const vector<Token>& tokens){
+    vector<pair<unsigned long, unsigned long>> ranges;
+    unsigned long i = 0;
+    while(tokens[i].type != "eof"){
+        unsigned long begin = i;
+        while(tokens[i].type != "{" && tokens[i].type != "eof"){
+            ++i;
+        }
+        for(long depth = 0; tokens[i].type != "eof"; ){
+            depth += (tokens[i].type == "{") - (tokens[i].type == "}");
+            if(++i, depth <= 0){
+                break;
+            }
+        }
+        ranges.push_back({begin, i});
+    }
+    return ranges;
+}
+
+
 struct Parser {
     Program program;
 
+    // the parser moves each token's value into the AST rather than copying it, so the tokens it has
+    // been over are left without theirs
     Parser(Token *tokens){
         it = tokens;
-        program = parse_program();
+        parse_program();
+    }
+
+    // just the function starting at tokens
+    static Function function(Token *tokens){
+        Parser parser;
+        parser.it = tokens;
+        return parser.parse_function();
+    }
+
+    // the functions are parsed apart on up to jobs threads, then put back in order
+    static Program parse(vector<Token>& tokens, unsigned long jobs){
+        if(jobs == 1){
+            return std::move(Parser{tokens.data()}.program);
+        }
+        auto ranges = function_ranges(tokens);
+        Program program;
+        program.functions.resize(ranges.size());
+        parallel_for(ranges.size(), jobs, [&](unsigned long i){
+            program.functions[i] = function(&tokens[ranges[i].first]);
+        });
+        return program;
     }
 
 
 
     private:
+    struct Pending {   // parse_expression()'s stack
+        enum { prefix, binary, group, index, call } kind;
+        string text;    // the operator, or the name indexed or called
+        int precedence = 0;
+        vector<Expr> arguments;     // a call's so far
+    };
+
     Token *it;
+    // kept from one expression to the next, so only the first ones in a program grow them
+    vector<Pending> pending;
+    vector<Expr> operands;
+
+    Parser() = default;
 
-    bool is(string expected_type){
+    // these run for every token, so they take views and build nothing on the heap
+    bool is(string_view expected_type){
         return it->type == expected_type;
     }
-    bool was(string expected_type){
+    bool was(string_view expected_type){
         bool _is = is(expected_type);
         if(_is){
             ++it;
@@ -39,8 +120,8 @@ struct Parser {
         return _is;
     }
 
-    optional<string> was(const vector<string>& expected_tokens){
-        for(const string& expected_token : expected_tokens){
+    optional<string_view> was(initializer_list<string_view> expected_tokens){
+        for(string_view expected_token : expected_tokens){
             if(was(expected_token)){
                 return expected_token;
             }
@@ -50,23 +131,21 @@ struct Parser {
 
 
 
-    string expect(string expected_type){
+    string expect(string_view expected_type){
         if(!is(expected_type) ){
             //cerr << "Expected " << expected_type << " but saw "; 
             cerr << "oh no, wanted  " << expected_type << " but we got " << it->type << "\n";
-            exit(EXIT_FAILURE);
+            compile_error();
         }
-        string value = it->value;
+        string value = std::move(it->value);
         ++it;
         return value;
     }
 
-    Program parse_program(){
-        Program p;
+    void parse_program(){
         while(!is("eof")){
-            p.functions.push_back(parse_function());
+            program.functions.push_back(parse_function());
         }
-        return p;
     }
 
     Function parse_function(){
@@ -74,6 +153,18 @@ struct Parser {
 
         f.name = expect("id");
         expect("(");
+        while(!is(")")){
+            Parameter p;
+            p.name = expect("id");
+            if(was("[")){
+                expect("]");
+                p.array = true;
+            }
+            f.parameters.push_back(std::move(p));
+            if(!was(",")){
+                break;
+            }
+        }
         expect(")");
 
         f.body = parse_block(); 
@@ -101,6 +192,21 @@ struct Parser {
         if(was("[")){   
             v_d.array_size = expect("int"); 
             expect("]");
+            if(was("=")){ // = {} zeroes the whole array
+                expect("{");
+                v_d.initializer.emplace();
+                while(!is("}")){
+                    v_d.initializer->push_back(parse_expression());
+                    if(!was(",")){
+                        break;
+                    }
+                }
+                expect("}");
+                if(v_d.initializer->size() > stoul(*v_d.array_size)){
+                    cerr << "too many initializers for " << v_d.name << "[" << *v_d.array_size << "]\n";
+                    compile_error();
+                }
+            }
         }
         return v_d;
     }
@@ -116,6 +222,30 @@ struct Parser {
                 }
             }
         }
+        if(was("return")){
+            return Return{parse_expression()};
+        }
+        if(was("loop")){
+            return Loop{parse_block()};
+        }
+        if(was("break")){
+            return Break{};
+        }
+        if(was("continue")){
+            return Continue{};
+        }
+        if(was("if")){
+            If i;
+            i.cond = parse_expression();
+            i.if_body = parse_block();
+            if(was("else")){
+                i.else_body = parse_block();
+            }
+            return i;
+        }
+        if(is("{")){
+            return parse_block();
+        }
         Expr lhs = parse_expression();
         if(!was("=")){
             return lhs;
@@ -123,136 +253,472 @@ struct Parser {
         return Assign{std::move(lhs), parse_expression()}; 
     }
 
+    // precedence climbing on stacks of its own rather than recursing, so how deep an expression can nest
+    // is up to memory and not the native stack. binary operators wait on the stack until one of lower or
+    // equal precedence comes, as all are left associative, or the bracket they are in closes. prefix
+    // operators wait for their primary. brackets are on it too: ( groups, [ indexes, and a call
+    // collects its arguments
     Expr parse_expression(){
-        return parse_relational();
-    }
-
+        // empty again when it returns, an expression nested in this one is parsed on the same stacks
+        auto pop = [&]{
+            Expr e = std::move(operands.back());
+            operands.pop_back();
+            return e;
+        };
+        // a primary is whole, the prefix operators right before it apply to it
+        auto primary = [&](Expr e){
+            while(!pending.empty() && pending.back().kind == Pending::prefix){
+                UnaryOperation unary{{}, std::move(pending.back().text)};
+                unary.lhs.push_back(std::move(e));  // {std::move(e)} would copy, the whole tree below
+                e = std::move(unary);
+                pending.pop_back();
+            }
+            operands.push_back(std::move(e));
+        };
 
-    Expr parse_relational(){
-        Expr lhs = parse_add();
         while(1){
-            optional<string> op = was({">", "<", "<=",">=", "==", "!="});
-            if(op){
-                lhs = BinaryOperation{{std::move(lhs), parse_add()}, *op}; 
+            if(optional<string_view> op = was({"+", "-", "~", "!"})){
+                pending.push_back({Pending::prefix, string(*op)});
+                continue;
+            }
+            if(was("(")){
+                pending.push_back({Pending::group});
+                continue;
+            }
+            if(is("int")){
+                primary(IntegerLiteral{expect("int")});
+            }
+            else if(is("id")){
+                string name = expect("id");
+                if(was("[")){
+                    pending.push_back({Pending::index, std::move(name)});
+                    continue;
+                }
+                if(!was("(")){
+                    primary(VariableAccess{std::move(name)});
+                }
+                else if(name == "puts"){
+                    FunctionCall call;
+                    call.name = std::move(name);
+                    call.arguments.push_back(StringLiteral{expect("str")});
+                    expect(")");
+                    primary(std::move(call));
+                }
+                else if(was(")")){
+                    primary(FunctionCall{std::move(name)});
+                }
+                else{
+                    pending.push_back({Pending::call, std::move(name)});
+                    continue;
+                }
             }
             else{
-                return lhs;
+                cerr << "Parse Expression Failed D:\n";
+                cerr << "\n";
+                compile_error();
             }
-        }
-    }
-
-
 
+            // after an operand comes a binary operator, or the end of the innermost bracket
+            while(1){
+                int precedence = binary_precedence();
+                while(!pending.empty() && pending.back().kind == Pending::binary
+                        && (!precedence || pending.back().precedence >= precedence)){
+                    BinaryOperation binary{vector<Expr>(2), std::move(pending.back().text)};
+                    binary.args[1] = pop();
+                    binary.args[0] = pop();
+                    operands.push_back(std::move(binary));
+                    pending.pop_back();
+                }
+                if(precedence){
+                    pending.push_back({Pending::binary, it->type, precedence});
+                    ++it;
+                    break;
+                }
+                if(pending.empty()){
+                    return pop();
+                }
 
-    Expr parse_add(){
-        Expr lhs = parse_mul();
-        while(1){
-            optional<string> op = was({"+", "-", "^", "|"});
-            if(op){
-                lhs = BinaryOperation{{std::move(lhs), parse_mul()}, *op}; 
-            }
-            else{
-                return lhs;
+                Pending bracket = std::move(pending.back());
+                pending.pop_back();
+                if(bracket.kind == Pending::group){
+                    expect(")");
+                    primary(pop());
+                }
+                else if(bracket.kind == Pending::index){
+                    expect("]");
+                    ArrayAccess aa;
+                    aa.name = std::move(bracket.text);
+                    aa.index.push_back(pop());
+                    primary(std::move(aa));
+                }
+                else{
+                    bracket.arguments.push_back(pop());
+                    if(was(",") && !is(")")){ // the next argument
+                        pending.push_back(std::move(bracket));
+                        break;
+                    }
+                    expect(")");
+                    primary(FunctionCall{std::move(bracket.text), std::move(bracket.arguments)});
+                }
             }
         }
     }
 
-    Expr parse_mul(){
-        Expr lhs = parse_unary();
-        while(1){
-            optional<string> op = was({"<<", ">>", "&", "*", "/", "%" });
-            if(op){
-                lhs = BinaryOperation{{std::move(lhs), parse_unary()}, *op}; 
-            }
-            else{
-                return lhs;
+    // how tightly the binary operator at it binds, 0 if it isn't one
+    int binary_precedence(){
+        static constexpr string_view levels[3][6] = {   // "" fills the short rows, no token's type is empty
+            {">", "<", "<=", ">=", "==", "!="}, {"+", "-", "^", "|"}, {"<<", ">>", "&", "*", "/", "%"},
+        };
+        for(int level = 0; level < 3; ++level){
+            for(string_view op : levels[level]){
+                if(is(op)){
+                    return level + 1;
+                }
             }
         }
+        return 0;
     }
 
+};
 
-    Expr parse_unary(){
-        while(1){
-            optional<string> op = was({"+", "-", "~", "!"}); 
-            if(op){
-                return UnaryOperation{{parse_unary()}, *op}; 
-            }
-            else{
-                return parse_primary();
-            }
+
+// gathers tokens until they make up a whole function, its braces matched as function_ranges() would
+struct FunctionSplitter {
+    // true once the tokens so far are a function, or at eof are left over, for take() to parse
+    bool add(Token token){
+        bool eof = token.type == "eof";
+        if(token.type == "{" || opened && token.type == "}"){
+            depth += token.type == "{" ? 1 : -1;
+            opened = true;
         }
+        if(!eof){
+            tokens.push_back(std::move(token));
+        }
+        return opened && depth == 0 || eof && !tokens.empty();
     }
 
+    Function take(){
+        tokens.push_back(Token{"eof", "", tokens.back().line});
+        Function f = Parser::function(tokens.data());
+        tokens.clear();
+        depth = 0;
+        opened = false;
+        return f;
+    }
 
-    Expr parse_primary(){
-        if(is("int")){
-            return IntegerLiteral{expect("int")};
-        }
-        if(was("(")){
-            Expr e = parse_expression();
-            expect(")");
-            return e;
-        }
-        if(is("id")){
-            string name = expect("id");
+    private:
+        vector<Token> tokens;
+        long depth = 0;
+        bool opened = false;
+};
 
-            if(was("[")){ 
-                ArrayAccess aa;
-                aa.name = std::move(name);
-                aa.index.push_back(parse_expression()); 
-                expect("]");
-                return aa;
-            }
 
-            if(was("(")){ 
-                FunctionCall call;
-                call.name = std::move(name);
-                while(!is(")")){
-                    call.arguments.push_back(parse_expression());
-                    if(!is(",")){
-                        break;
-                    }
-                    expect(",");
-                }
-                expect(")");
-                return call;
-            }
+// print, putch and puts, done inside the module so the host isn't called once per character. all
+// append to a 4KiB buffer at 0, which goes out through one write(pointer, length) call whenever it
+// fills up and when main returns. the buffer has the first page to itself: the program's 64KiB is the
+// second one, PROGRAM_MEMORY up, and the memory ends with it, so the program can't reach the buffer
+// and traps on the same addresses as --run, --jit and --emit-c. strings and tables aren't in memory
+// at all, they are in the passive segment $rt:data that puts and initializers copy from
+static const unsigned long PROGRAM_MEMORY = 65536;
+
+static const char *OUTPUT_RUNTIME = R"(
+(global $rt:length (mut i32) (i32.const 0))
+(func $rt:flush
+global.get $rt:length
+if
+i32.const 0
+global.get $rt:length
+call $write
+i32.const 0
+global.set $rt:length
+end
+         )
+(func $rt:byte (param $c i32)
+global.get $rt:length
+local.get $c
+i32.store8
+global.get $rt:length
+i32.const 1
+i32.add
+global.set $rt:length
+global.get $rt:length
+i32.const 4096
+i32.eq
+if
+call $rt:flush
+end
+         )
+(func $putch (param $c i32) (result i32)
+local.get $c
+call $rt:byte
+i32.const 0
+         )
+(func $puts (param $at i32) (param $length i32) (result i32)
+(local $chunk i32)
+loop $more ;; as much as the buffer has room for at a time, $at is where the string is in $rt:data
+i32.const 4096
+global.get $rt:length
+i32.sub
+local.tee $chunk
+local.get $length
+local.get $chunk
+local.get $length
+i32.lt_u
+select
+local.set $chunk
+global.get $rt:length
+local.get $at
+local.get $chunk
+memory.init $rt:data
+global.get $rt:length
+local.get $chunk
+i32.add
+global.set $rt:length
+global.get $rt:length
+i32.const 4096
+i32.eq
+if
+call $rt:flush
+end
+local.get $at
+local.get $chunk
+i32.add
+local.set $at
+local.get $length
+local.get $chunk
+i32.sub
+local.tee $length
+br_if $more
+end
+i32.const 0
+         )
+(func $print (param $value i32) (result i32)
+(local $digits i32) (local $at i32) (local $rest i32)
+;; a sign, ten digits and the newline take at most 12 bytes, room is made for them up front
+global.get $rt:length
+i32.const 4084
+i32.gt_u
+if
+call $rt:flush
+end
+local.get $value
+i32.const 0
+i32.lt_s
+if
+i32.const 45
+call $rt:byte
+i32.const 0
+local.get $value
+i32.sub
+local.set $value ;; the magnitude, unsigned from here on so -2147483648 works out too
+end
+i32.const 1
+local.set $digits
+local.get $value
+local.set $rest
+block $counted
+loop $count
+local.get $rest
+i32.const 10
+i32.lt_u
+br_if $counted
+local.get $rest
+i32.const 10
+i32.div_u
+local.set $rest
+local.get $digits
+i32.const 1
+i32.add
+local.set $digits
+br $count
+end
+end
+global.get $rt:length
+local.get $digits
+i32.add
+local.tee $at
+global.set $rt:length
+loop $digit ;; lowest digit last
+local.get $at
+i32.const 1
+i32.sub
+local.tee $at
+local.get $value
+i32.const 10
+i32.rem_u
+i32.const 48
+i32.add
+i32.store8
+local.get $value
+i32.const 10
+i32.div_u
+local.tee $value
+br_if $digit
+end
+i32.const 10
+call $rt:byte
+i32.const 0
+         )
+)";
 
-            return VariableAccess{std::move(name)}; 
 
+struct Codegen{
+    stringstream wasm;
+    struct Size {
+        unsigned long instructions, locals;
+    };
+    vector<Size> sizes;     // each function's, for --time-report
+
+    // one function's wasm. the strings and tables it uses are @0, @1, ... in it until assemble()
+    // gives them their place in $rt:data, so functions can be generated on their own
+    struct Generated {
+        string wasm;
+        vector<string> data;
+        unsigned long instructions = 0, locals = 0;     // for --time-report
+    };
+
+    // functions are generated on up to jobs threads, each into its own Codegen
+    Codegen(Program& program, bool bounds_check = false, unsigned long jobs = 1) {
+        vector<Generated> functions(program.functions.size());
+        parallel_for(functions.size(), jobs, [&](unsigned long i){
+            functions[i] = function(program.functions[i], bounds_check);
+        });
+        for(auto& g : functions){
+            sizes.push_back({g.instructions, g.locals});
         }
 
+        unsigned long main_parameters = 0;
+        for(auto& f : program.functions){
+            if(f.name == "main"){
+                main_parameters = f.parameters.size();
+            }
+        }
+        wasm << assemble(functions, main_parameters);
+    }
 
-        cerr << "Parse Expression Failed D:\n";
-        cerr << "\n";
-        exit(EXIT_FAILURE);
+    // the state generating one function needs is this Codegen's, so functions can be generated at once
+    static Generated function(Function& f, bool bounds_check = false){
+        Codegen gen{bounds_check};
+        gen.gen_function(f);
+        string inst = gen.inst.str(), decl = gen.decl.str();
+        return {gen.wasm.str(), std::move(gen.data), (unsigned long)count(inst.begin(), inst.end(), '\n'),
+                (unsigned long)count(decl.begin(), decl.end(), '\n') + f.parameters.size()};
     }
 
-};
+    // lays the module out around the functions as they come in, so it can be written out while later
+    // ones are still being generated. the strings and tables they use go in $rt:data at the end
+    struct Assembler {
+        Assembler(ostream& wasm) : wasm(wasm) {
+            wasm << "(module\n";
+            wasm << " (import \"env\" \"write\" (func $write (param i32 i32)))\n";
+            
+            wasm << "(global $stack_ptr (mut i32) (i32.const 0))\n";
+            wasm << OUTPUT_RUNTIME;
+        }
 
+        void add(const Generated& g){
+            vector<unsigned long> addresses;
+            for(auto& bytes : g.data){
+                if(!segments.contains(bytes)){
+                    segments[bytes] = data.size();
+                    data += bytes;
+                }
+                addresses.push_back(segments[bytes]);
+            }
 
-struct Codegen{
-    stringstream wasm;
+            unsigned long from = 0;
+            for(unsigned long at; (at = g.wasm.find('@', from)) != string::npos; ){
+                size_t digits;
+                unsigned long index = stoul(g.wasm.substr(at + 1, 20), &digits);
+                wasm.write(g.wasm.data() + from, at - from);
+                wasm << addresses[index];
+                from = at + 1 + digits;
+            }
+            wasm.write(g.wasm.data() + from, g.wasm.size() - from);
+        }
+
+        void finish(unsigned long main_parameters){
+            // the output buffer's page, then the program's, and no more. puts is there either way, so
+            // $rt:data is too, if empty
+            unsigned long pages = (PROGRAM_MEMORY + 65536) / 65536;
+            wasm << "(memory $memory " << pages << " " << pages << ")\n";
+            wasm << "(data $rt:data \"";
+            for(unsigned char ch : data){
+                static const char *hex = "0123456789abcdef";
+                if(ch >= ' ' && ch < 127 && ch != '"' && ch != '\\'){
+                    wasm << ch;
+                }
+                else{
+                    wasm << '\\' << hex[ch >> 4] << hex[ch & 15];
+                }
+            }
+            wasm << "\")\n";
+
+            // the exported main flushes what the program printed once it returns, after a trap the host calls flush
+            wasm << "(func $rt:main (result i32)\n";
+            for(unsigned long i = 0; i < main_parameters; ++i){ // as the page calls it, undefined is 0
+                wasm << "i32.const 0\n";
+            }
+            wasm << "call $main\n";
+            wasm << "call $rt:flush\n";
+            wasm << "         )\n";
+
+            wasm << "(export \"main\" (func $rt:main))\n";
+            wasm << "(export \"flush\" (func $rt:flush))\n";
+            wasm << "(export \"memory\" (memory $memory))\n";
+            wasm << ")\n";
+        }
 
-    Codegen(Program& program){
-        gen_program(program);
+        private:
+            ostream& wasm;
+            string data;                                    // read only bytes, each distinct string or table once
+            unordered_map<string, unsigned long> segments;  // those bytes -> where they are in it
+    };
+
+    // the module around the functions, in their order
+    static string assemble(const vector<Generated>& functions, unsigned long main_parameters){
+        stringstream wasm;
+        Assembler assembler{wasm};
+        for(auto& g : functions){
+            assembler.add(g);
+        }
+        assembler.finish(main_parameters);
+        return wasm.str();
+    }
 
-    }   
     private:
+        Codegen(bool bounds_check) : bounds_check(bounds_check) {}
+
         stringstream decl, inst; 
-        unsigned long mangle_counter, stack_counter; 
+        unsigned long mangle_counter, stack_counter, label_counter; 
+        bool bounds_check, bounds_local; 
+        vector<unsigned long> loops;     // innermost last, targets of break/continue
+        vector<string> return_labels;    // innermost last, targets of return
+        vector<string> data;                            // read only bytes this function uses
+        unordered_map<string, unsigned long> segments;  // those bytes -> their index in data
+
+        string constant_data(const string& bytes){
+            if(!segments.contains(bytes)){
+                segments[bytes] = data.size();
+                data.push_back(bytes);
+            }
+            return "@" + to_string(segments[bytes]);
+        }
 
         string mangle(const string& name){
-            return name + to_string(mangle_counter);
+            return name + to_string(mangle_counter++);
         }
 
         struct Symbol{
             string mangled_name;
             bool is_array;
+            bool is_pointer = false;
+            optional<unsigned long> array_size;     // only local arrays have one, others can't be bounds checked
         };
 
         struct SymbolTable{ 
             vector<unordered_map<string, Symbol>> scopes;
+            unsigned long floor = 0;    // scopes below this are hidden, an inlined body can't see its caller's locals
 
             void operator++(){  
                 scopes.push_back({});
@@ -263,7 +729,7 @@ struct Codegen{
 
             Symbol& operator[](const string& name){ 
                 auto it = scopes.rbegin(); 
-                auto end = scopes.rend();
+                auto end = scopes.rend() - floor;
 
                 for(; it != end; ++it){ 
                     auto& scope = *it;
@@ -272,7 +738,7 @@ struct Codegen{
                     }
                 }
                 cerr << "oh we looked up " << name << " but never found a symbol for it\n";
-                exit(EXIT_FAILURE);
+                compile_error();
             }
 
         } symbols; 
@@ -282,42 +748,165 @@ struct Codegen{
             auto& scope = symbols.scopes.back();
             if(scope.contains(dec.name)){
                 cerr << "Attempted redeclaration of " << dec.name << "\n";
-                exit(EXIT_FAILURE);
+                compile_error();
             }
-            scope[dec.name] = Symbol{mangle(dec.name), dec.array_size.has_value()};
+            scope[dec.name] = Symbol{mangle(dec.name), dec.array_size || dec.pointer, dec.pointer};
 
             if(dec.array_size){ 
                 stack_counter += stoul(*dec.array_size); 
+                scope[dec.name].array_size = stoul(*dec.array_size);
             }
         }
 
+        // name[index] is pushed in two halves around the index expression, so gen_expression can
+        // generate that in between without recursing. offset is a constant part of the index, in bytes,
+        // for the load/store offset immediate so a[3] or a[i + 3] don't spend instructions on it
+        struct Address {
+            Expr *index = nullptr;          // what is left to generate, if anything
+            optional<unsigned long> check;  // the array's size, when the index is checked against it
+            unsigned long offset = 0;
+        };
 
+        // pushes the array's base and works out what its index still needs
+        Address address_start(Symbol& s, ArrayAccess& aa){
+            inst << "local.get $" << s.mangled_name << "\n";
+            Expr& index = aa.index[0];
 
+            if(bounds_check && s.array_size && !aa.in_bounds){ // negative indices fail the unsigned compare too
+                if(!bounds_local){
+                    decl << "(local $bounds i32)\n";
+                    bounds_local = true;
+                }
+                return {&index, s.array_size};
+            }
 
-    void gen_program(Program& program){
-        wasm << "(module\n";
-        wasm << " (import \"env\" \"print\" (func $print (param i32) (result i32)))\n";
-        wasm << " (import \"env\" \"putch\" (func $putch (param i32) (result i32)))\n";
-        
-        wasm << "(memory 1 65536)\n"; 
-        wasm << "(global $stack_ptr (mut i32) (i32.const 0))\n";
+            Expr *variable = &index;
+            long long offset = 0;
+            auto *binop = get_if<BinaryOperation>(&index);
+            if(auto c = Folder::constant(index)){
+                variable = nullptr;
+                offset = *c;
+            }
+            else if(binop && binop->opcode == "+"){
+                if(auto c = Folder::constant(binop->args[1])){
+                    variable = &binop->args[0];
+                    offset = *c;
+                }
+            }
+            if(offset < 0 || offset >= (1 << 28)){ // the immediate is unsigned
+                variable = &index;
+                offset = 0;
+            }
+            return {variable, {}, 4 * (unsigned long)offset};
+        }
 
-        for(auto& f : program.functions){
-            gen_function(f);
+        // adds the index, which is on the stack if there is one, to the base
+        void address_end(const Address& a){
+            if(a.check){
+                inst << "local.tee $bounds\n";
+                inst << "local.get $bounds\n";
+                inst << "i32.const " << *a.check << "\n";
+                inst << "i32.ge_u\n";
+                inst << "if\nunreachable\nend\n";
+            }
+            if(a.index){
+                inst << "i32.const 4\ni32.mul\ni32.add\n";
+            }
+        }
+
+        // pushes the address of name[index] less the constant byte offset it returns
+        unsigned long gen_address(Symbol& s, ArrayAccess& aa){
+            Address a = address_start(s, aa);
+            if(a.index){
+                gen_expression(*a.index);
+            }
+            address_end(a);
+            return a.offset;
+        }
+
+        // a table of constants is copied in from $rt:data, other elements are stored one by one, and the
+        // rest of the array is zeroed with a single memory.fill. the two take whole addresses, so
+        // PROGRAM_MEMORY is added to them, where loads and stores have it in their offset
+        void gen_initializer(Symbol& s, vector<Expr>& elements){
+            string table;
+            bool constant = true;
+            for(auto& e : elements){
+                auto value = Folder::value(e);
+                constant = constant && value;
+                for(int i = 0; value && i < 4; ++i){
+                    table += (char)((uint32_t)*value >> 8 * i);
+                }
+            }
+
+            unsigned long initialized = 0;
+            if(constant){
+                while(table.ends_with(string(4, '\0'))){ // trailing zeros are left to the fill
+                    table.resize(table.size() - 4);
+                }
+                if(!table.empty()){
+                    inst << "local.get $" << s.mangled_name << "\n";
+                    inst << "i32.const " << PROGRAM_MEMORY << "\ni32.add\n";
+                    inst << "i32.const " << constant_data(table) << "\n";
+                    inst << "i32.const " << table.size() << "\n";
+                    inst << "memory.init $rt:data\n";
+                }
+                initialized = table.size();
+            }
+            else{
+                for(unsigned long i = 0; i < elements.size(); ++i){
+                    inst << "local.get $" << s.mangled_name << "\n";
+                    gen_expression(elements[i]);
+                    inst << "i32.store" << offset_immediate(4 * i) << "\n";
+                }
+                initialized = 4 * elements.size();
+            }
+
+            if(initialized < 4 * *s.array_size){
+                inst << "local.get $" << s.mangled_name << "\n";
+                inst << "i32.const " << PROGRAM_MEMORY + initialized << "\ni32.add\n";
+                inst << "i32.const 0\n";
+                inst << "i32.const " << 4 * *s.array_size - initialized << "\n";
+                inst << "memory.fill\n";
+            }
+        }
+
+        // where the program's address 0 is goes in with the offset, as wasm adds it without wrapping
+        static string offset_immediate(unsigned long offset){
+            return " offset=" + to_string(PROGRAM_MEMORY + offset);
+        }
+
+        Symbol& param_push(const Parameter& p){
+            auto& scope = symbols.scopes.back();
+            if(scope.contains(p.name)){
+                cerr << "Attempted redeclaration of parameter " << p.name << "\n";
+                compile_error();
+            }
+            return scope[p.name] = Symbol{mangle(p.name), p.is_array()};
         }
 
-        wasm << "(export \"main\" (func $main))\n";
-        wasm << ")\n";
-    } 
+
 
 
     void gen_function(Function& f){
         decl = {}; 
         inst = {}; 
-        mangle_counter = stack_counter = 0; 
+        mangle_counter = stack_counter = label_counter = 0; 
+        bounds_local = false;
 
-        wasm << "(func $" << f.name << " (result i32)\n";
+        wasm << "(func $" << f.name;
+        ++symbols;
+        for(auto& p : f.parameters){
+            wasm << " (param $" << param_push(p).mangled_name << " i32)";
+        }
+        wasm << " (result i32)\n";
+
+        return_labels.push_back("return");
+        inst << "block $return (result i32)\n";
         gen_block(f.body); 
+        inst << "i32.const 0\n";   // falling off the end returns 0
+        inst << "end\n";
+        return_labels.pop_back();
+        --symbols;
 
 
         wasm << decl.str(); 
@@ -338,9 +927,6 @@ struct Codegen{
         wasm << "global.set $stack_ptr\n"; 
         wasm << ";; ~function epilogue\n";
 
-
-
-        wasm << "i32.const 0\n";
         wasm << "         )\n";
     }
 
@@ -370,18 +956,63 @@ struct Codegen{
                     inst << "i32.const " << (4 * stack_counter) << "\n"; 
                     inst << "i32.sub\n";
                     inst << "local.set $" << s.mangled_name << "\n";
+                    if(declaration.initializer){
+                        gen_initializer(s, *declaration.initializer);
+                    }
                 }
                 else{  
                     decl << "(local $" << s.mangled_name << " i32)\n";
+                    if(return_labels.size() > 1){ // an inlined body runs again without a fresh call frame zeroing its locals
+                        inst << "i32.const 0\n";
+                        inst << "local.set $" << s.mangled_name << "\n";
+                    }
                 }
             }
         }
+        else if(auto *block = get_if<Block>(&s)){
+            gen_block(*block);
+        }
+        else if(auto *ret = get_if<Return>(&s)){
+            gen_expression(ret->return_value);
+            inst << "br $" << return_labels.back() << "\n";
+        }
+        else if(auto *loop = get_if<Loop>(&s)){
+            if(loop->vectorized){
+                gen_vector_loop(*loop);
+            }
+            unsigned long label = label_counter++;
+            loops.push_back(label);
+            inst << "block $break" << label << "\n";
+            inst << "loop $continue" << label << "\n";
+            gen_block(loop->body);
+            inst << "br $continue" << label << "\n";
+            inst << "end\n";
+            inst << "end\n";
+            loops.pop_back();
+        }
+        else if(holds_alternative<Break>(s) || holds_alternative<Continue>(s)){
+            if(loops.empty()){
+                cerr << "break or continue outside of a loop\n";
+                compile_error();
+            }
+            inst << "br $" << (holds_alternative<Break>(s) ? "break" : "continue") << loops.back() << "\n";
+        }
+        else if(auto *branch = get_if<If>(&s)){
+            gen_expression(branch->cond);
+            inst << "if\n";
+            gen_block(branch->if_body);
+            if(!branch->else_body.body.empty()){
+                inst << "else\n";
+                gen_block(branch->else_body);
+            }
+            inst << "end\n";
+        }
         else if(auto *assignment = get_if<Assign>(&s)){
             if(auto *lhs_var_acc = get_if<VariableAccess>(&assignment->lhs)){
                 Symbol& s = symbols[lhs_var_acc->name];
-                if(s.is_array){
+                if(s.is_array && !s.is_pointer){
                     cerr << "Attempted assignment to array like it was a variable\n";
-                    exit(EXIT_FAILURE);
+                    compile_error();
                 }
 
                 gen_expression(assignment->rhs);
@@ -391,41 +1022,217 @@ struct Codegen{
                 Symbol& s = symbols[lhs_var_acc->name];
                 if(!s.is_array){
                     cerr << "Attempted assignment to variable like it was an array\n";
-                    exit(EXIT_FAILURE);
+                    compile_error();
                 }
-                inst << "local.get $" << s.mangled_name << "\n"; 
-                gen_expression(lhs_var_acc->index[0]);  
-                inst << "i32.const 4\ni32.mul\ni32.add\n"; 
+                unsigned long offset = gen_address(s, *lhs_var_acc);
                 gen_expression(assignment->rhs); 
-                inst << "i32.store\n"; 
+                inst << "i32.store" << offset_immediate(offset) << "\n"; 
             }
             else{
                 cerr << "Tried to assign to an expression that isn't assignable\n";
-                exit(EXIT_FAILURE);
+                compile_error();
             }
         }
         else{
             cerr << "unhandled statment type\n";
-            exit(EXIT_FAILURE);
+            compile_error();
+        }
+    }
+
+    // the Vectorizer's loop shape: if i >= n { break }, element-wise stores, i = i + 1. runs the stores
+    // on four elements at a time while i + 4 <= n, the scalar loop after it does the rest
+    void gen_vector_loop(Loop& loop){
+        auto& body = loop.body.body;
+        auto& cmp = get<BinaryOperation>(get<If>(body.front()).cond);
+        const string& i = get<VariableAccess>(get<Assign>(body.back()).lhs).name;
+        auto *lhs = get_if<VariableAccess>(&cmp.args[0]);
+        Expr& bound = lhs && lhs->name == i ? cmp.args[1] : cmp.args[0];
+        Symbol& counter = symbols[i];
+
+        unsigned long label = label_counter++;
+        inst << "block $simd_break" << label << "\n";
+        inst << "loop $simd_continue" << label << "\n";
+        inst << "local.get $" << counter.mangled_name << "\n";
+        inst << "i32.const 4\ni32.add\n";
+        gen_expression(bound);
+        inst << "i32.gt_s\n";
+        inst << "br_if $simd_break" << label << "\n";
+        for(unsigned long k = 1; k + 1 < body.size(); ++k){
+            auto& store = get<Assign>(body[k]);
+            auto& dest = get<ArrayAccess>(store.lhs);
+            unsigned long offset = gen_address(symbols[dest.name], dest);
+            gen_lanes(store.rhs);
+            inst << "v128.store" << offset_immediate(offset) << "\n";
         }
+        inst << "local.get $" << counter.mangled_name << "\n";
+        inst << "i32.const 4\ni32.add\n";
+        inst << "local.set $" << counter.mangled_name << "\n";
+        inst << "br $simd_continue" << label << "\n";
+        inst << "end\n";
+        inst << "end\n";
     }
 
-    void gen_expression(Expr& e){
-        if(auto * lit = get_if<IntegerLiteral>(&e)){
-           inst << "i32.const " << lit->value << "\n";
+    // pushes e for four consecutive values of the loop counter, scalars are the same in every lane.
+    // post-order on a stack of its own like gen_expression, a node's second time off it emits its op
+    void gen_lanes(Expr& root){
+        vector<pair<Expr*, bool>> lanes{{&root, false}};
+        while(!lanes.empty()){
+            auto [e, finishing] = lanes.back();
+            lanes.pop_back();
+            if(auto *aa = get_if<ArrayAccess>(e)){
+                unsigned long offset = gen_address(symbols[aa->name], *aa);
+                inst << "v128.load" << offset_immediate(offset) << "\n";
+            }
+            else if(auto *unop = get_if<UnaryOperation>(e)){
+                if(!finishing){
+                    lanes.push_back({e, true});
+                    lanes.push_back({&unop->lhs[0], false});
+                }
+                else if(unop->opcode == "-"){
+                    inst << "i32x4.neg\n";
+                }
+                else if(unop->opcode == "~"){
+                    inst << "v128.not\n";
+                }
+            }
+            else if(auto *binop = get_if<BinaryOperation>(e)){
+                bool shift = binop->opcode == "<<" || binop->opcode == ">>";
+                if(!finishing){
+                    lanes.push_back({e, true});
+                    if(!shift){
+                        lanes.push_back({&binop->args[1], false});
+                    }
+                    lanes.push_back({&binop->args[0], false});
+                }
+                else if(shift){ // the shift count stays a scalar
+                    gen_expression(binop->args[1]);
+                    inst << (binop->opcode == "<<" ? "i32x4.shl\n" : "i32x4.shr_s\n");
+                }
+                else{
+                    static const unordered_map<string, string> ops{
+                        {"+", "i32x4.add"}, {"-", "i32x4.sub"}, {"*", "i32x4.mul"},
+                        {"&", "v128.and"}, {"|", "v128.or"}, {"^", "v128.xor"},
+                    };
+                    inst << ops.at(binop->opcode) << "\n";
+                }
+            }
+            else{
+                gen_expression(*e);
+                inst << "i32x4.splat\n";
+            }
         }
-        else if(auto *call = get_if<FunctionCall>(&e)){
-            for(auto& arg : call->arguments){
-                gen_expression(arg);
+    }
+
+    // post-order on a stack of its own rather than recursing, so how deep an expression can nest is up to
+    // memory and not the native stack. a node comes off it twice, first to go back on, finishing, above
+    // its operands, then once they have been generated to emit what it does with them
+    void gen_expression(Expr& root){
+        unsigned long base = steps.size();  // an inlined body's expressions are generated on top
+        steps.push_back({&root});
+        while(steps.size() > base){
+            Step step = steps.back();
+            steps.pop_back();
+            Expr& e = *step.e;
+            if(step.finishing){
+                gen_operation(step);
+            }
+            else if(auto *lit = get_if<IntegerLiteral>(&e)){
+                inst << "i32.const " << lit->value << "\n";
+            }
+            else if(auto *call = get_if<FunctionCall>(&e)){
+                if(call->name == "puts"){
+                    auto& text = get<StringLiteral>(call->arguments[0]).value;
+                    inst << "i32.const " << constant_data(text) << "\n";
+                    inst << "i32.const " << text.size() << "\n";
+                    inst << "call $puts\n";
+                    continue;
+                }
+                push_operands(e, call->arguments);
+            }
+            else if(auto *call = get_if<InlinedCall>(&e)){
+                push_operands(e, call->arguments);
+            }
+            else if(auto *UnaryOp = get_if<UnaryOperation>(&e)){
+                push_operands(e, UnaryOp->lhs);
+            }
+            else if(auto *BinaryOp = get_if<BinaryOperation>(&e)){
+                push_operands(e, BinaryOp->args);
             }
+            else if(auto *Var_acc = get_if<VariableAccess>(&e)){
+                Symbol& s = symbols[Var_acc->name];
+                inst << "local.get $" << s.mangled_name << "\n";
+            }
+            else if(auto *Arr_acc = get_if<ArrayAccess>(&e)){
+                Symbol& s = symbols[Arr_acc->name];
+                if(!s.is_array){
+                    cerr << "Old C stuff, denied :(\n";
+                    compile_error();
+                }
+                Address a = address_start(s, *Arr_acc);
+                steps.push_back({&e, true, a});
+                if(a.index){
+                    steps.push_back({a.index});
+                }
+            }
+            else{
+                cerr << "unhandled expression type\n";
+                compile_error();
+            }
+        }
+    }
+
+    struct Step {
+        Expr *e;
+        bool finishing = false;
+        Address address = {};   // an ArrayAccess's
+    };
+    vector<Step> steps;     // gen_expression's, kept so it doesn't allocate on every call
+
+    // e finishes once operands, the first on top, have been generated
+    void push_operands(Expr& e, vector<Expr>& operands){
+        steps.push_back({&e, true});
+        for(auto it = operands.rbegin(); it != operands.rend(); ++it){
+            steps.push_back({&*it});
+        }
+    }
+
+    // what a node does with its operands, which are on the wasm stack
+    void gen_operation(Step& step){
+        Expr& e = *step.e;
+        if(auto *call = get_if<FunctionCall>(&e)){
             inst << "call $" << call->name << "\n";
         }
 
-        else if(auto *UnaryOp = get_if<UnaryOperation>(&e)){
-            for(auto& arg : UnaryOp->lhs){
-                gen_expression(arg);
+        else if(auto *call = get_if<InlinedCall>(&e)){
+            string label = "inline_" + call->name + to_string(label_counter++);
+            unsigned long outer_floor = symbols.floor;
+            ++symbols;
+            symbols.floor = symbols.scopes.size() - 1;
+
+            vector<string> parameters;
+            for(auto& p : call->parameters){
+                parameters.push_back(param_push(p).mangled_name);
+                decl << "(local $" << parameters.back() << " i32)\n";
+            }
+            for(auto it = parameters.rbegin(); it != parameters.rend(); ++it){ // arguments were pushed in order
+                inst << "local.set $" << *it << "\n";
             }
 
+            auto outer_loops = std::move(loops);
+            loops = {};
+            return_labels.push_back(label);
+            inst << "block $" << label << " (result i32)\n";
+            gen_block(call->body);
+            inst << "i32.const 0\n";
+            inst << "end\n";
+            return_labels.pop_back();
+            loops = std::move(outer_loops);
+
+            --symbols;
+            symbols.floor = outer_floor;
+        }
+
+        else if(auto *UnaryOp = get_if<UnaryOperation>(&e)){
             if(UnaryOp->opcode == "+"){
 
             }
@@ -440,16 +1247,12 @@ struct Codegen{
             }
             else{
                 cerr << "UnaryOp unimplemented\n";
-                exit(EXIT_FAILURE);
+                compile_error();
             }
         }
 
 
         else if(auto *BinaryOp = get_if<BinaryOperation>(&e)){
-            for(auto& arg : BinaryOp->args){
-                gen_expression(arg);
-            }
-
             if(BinaryOp->opcode == "+"){
                 inst << "i32.add\n";
             }
@@ -500,67 +1303,630 @@ struct Codegen{
             }
             else{
                 cerr << "BinaryOp unimplemente\n";
-                exit(EXIT_FAILURE);
+                compile_error();
             }
         }
 
         
-        else if(auto *Var_acc = get_if<VariableAccess>(&e)){
-            Symbol& s = symbols[Var_acc->name];
-            inst << "local.get $" << s.mangled_name << "\n";
+        else if(holds_alternative<ArrayAccess>(e)){
+            address_end(step.address);
+            inst << "i32.load" << offset_immediate(step.address.offset) << "\n";
         }
+    }
+};
 
-        else if(auto *Arr_acc = get_if<ArrayAccess>(&e)){
-            Symbol& s = symbols[Arr_acc->name];
-            if(!s.is_array){
-                cerr << "Old C stuff, denied :(\n";
-                exit(EXIT_FAILURE);
-            }
-            
-            inst << "local.get $" << s.mangled_name << "\n";
-            gen_expression(Arr_acc->index[0]); 
-            inst << "i32.const 4\ni32.mul\ni32.add\n";
-            inst << "i32.load\n";   
-        }
 
-        else{
-            cerr << "unhandled expression type\n";
-            exit(EXIT_FAILURE);
-        }
-    }
+struct Options {
+    bool inline_functions = false;
+    unsigned long inline_budget = 40;   // in AST nodes, single call site functions are inlined regardless
+    bool inline_report = false;
+    bool fold = false;
+    bool specialize = false;
+    unsigned long specialize_limit = 4;  // clones per function
+    bool specialize_report = false;
+    bool strength_reduce = false;
+    bool licm = false;
+    bool bounds_check = false;
+    bool bounds_check_report = false;
+    bool simd = false;
+    bool simd_report = false;
+    bool run = false;   // interpret instead of printing the page
+    bool jit = false;   // run as x86-64 machine code instead
+    bool emit_c = false;    // print C99 instead of the page
+    string incremental;     // a directory to keep each function's wasm in between compiles
+    bool incremental_report = false;
+    bool pipeline = false;  // lex, parse and generate on three threads at once
+    bool stream = false;    // read, compile and write one function at a time
+    string time_report;     // "text" or "json" to measure each phase
+    TimeReport *report = nullptr;   // where they are measured, while building with a time_report
+    string cache;           // a directory to keep whole pages and C files in
+    unsigned long cache_limit = 256;    // entries, the least recently used go first
+    unsigned long jobs = max(1u, thread::hardware_concurrency());  // threads to generate functions on
 };
 
-// string indent(string wasm){
-//         string res;
-//         const char *it = wasm.c_str();
-//         int level =  0;
-//         while(*it){
-//             res += *it;
-//             if('\n' == *it){
-//                 for(int i = 0; i < level; ++i){
-//                     res += ' ';
-//                 }
-//             }
-//             if('(' == *it){
-//                 level += 2;
-//             }
-//             if(')' == *it){
-//                 level -= 2;
-//             }
-//             ++it;
-//         }
-//         return res;
-// }
 
+// runs work as the phase name of the --time-report, if there is one
+template<class F>
+void phase(const Options& options, const char *name, F&& work){
+    if(options.report){
+        options.report->time(name, work);
+    }
+    else{
+        work();
+    }
+}
 
 
+// the options that change what is built, and the compiler that builds it, for the caches' keys
+string fingerprint(const Options& options){
+    stringstream key;
+    key << COMPILER_BUILD << " inline=" << options.inline_functions << "/" << options.inline_budget
+        << " fold=" << options.fold << " specialize=" << options.specialize << "/" << options.specialize_limit
+        << " strength_reduce=" << options.strength_reduce << " licm=" << options.licm
+        << " bounds_check=" << options.bounds_check << " simd=" << options.simd << " emit_c=" << options.emit_c << "\n";
+    return key.str();
+}
 
 
-void expression_run(){
-    const char *source = R"(
-        main () {
-            print(1 + 1 - 2)  // 0
-            print(9 - 4 * 2)  // 1
+// runs the enabled passes, what Codegen or the Interpreter then take
+void optimize(Program& program, const Options& options){
+    if(options.fold || options.specialize){ // before they can drop code with errors in it
+        phase(options, "names", [&]{ Names{program}; });
+    }
+    if(options.fold || options.specialize){
+        phase(options, "fold", [&]{ Folder{program}; });
+    }
+    if(options.specialize){
+        phase(options, "specialize", [&]{
+            Specializer specializer{program, options.specialize_limit};
+            if(options.specialize_report){
+                cerr << specializer.report.str();
+            }
+        });
+    }
+    if(options.inline_functions){
+        phase(options, "inline", [&]{
+            Inliner inliner{program, options.inline_budget};
+            if(options.inline_report){
+                cerr << inliner.report.str();
+            }
+        });
+    }
+    if(options.fold){ // inlined arguments are constants the callee can now fold with
+        phase(options, "fold", [&]{ Folder{program}; });
+    }
+    if(options.bounds_check){ // marks accesses the later passes and Codegen need not check
+        phase(options, "bounds check", [&]{
+            BoundsCheck bounds{program};
+            if(options.bounds_check_report){
+                cerr << bounds.report.str();
+            }
+        });
+    }
+    if(options.simd){ // before strength reduction, which leaves vectorized loops alone
+        phase(options, "simd", [&]{
+            Vectorizer vectorizer{program, options.bounds_check};
+            if(options.simd_report){
+                cerr << vectorizer.report.str();
+            }
+        });
+    }
+    if(options.strength_reduce){
+        phase(options, "strength reduce", [&]{ InductionVariables{program, options.bounds_check}; });
+    }
+    if(options.licm){ // after strength reduction, its exit bounds are invariant
+        phase(options, "licm", [&]{ Licm{program}; });
+    }
+}
+
+// inlining and specialization look across functions, and the reports are totals for the whole program.
+// without them a function can be optimized and generated on its own, and the result is the same
+bool per_function(const Options& options){
+    return !options.inline_functions && !options.specialize && !options.bounds_check_report && !options.simd_report;
+}
+
+Codegen::Generated generate(Function f, const Options& options){
+    Program program;
+    program.functions.push_back(std::move(f));
+    optimize(program, options);
+    Codegen::Generated g;
+    phase(options, "codegen", [&]{ g = Codegen::function(program.functions[0], options.bounds_check); });
+    if(options.report){
+        options.report->functions.push_back({program.functions[0].name, g.instructions, g.locals});
+    }
+    return g;
+}
+
+Program optimize(const char *source, const Options& options){
+    vector<Token> tokens;
+    phase(options, "lex", [&]{ tokens = Lexer{source}(); });
+    Program program;
+    phase(options, "parse", [&]{ program = Parser::parse(tokens, options.jobs); });
+    if(options.report){
+        unsigned long nodes = 0;
+        for(auto& f : program.functions){
+            walk_statements(f.body, [&](Stmt&){ ++nodes; });
+            walk(f.body, [&](Expr&){ ++nodes; });
+        }
+        options.report->count("tokens", tokens.size());
+        options.report->count("functions", program.functions.size());
+        options.report->count("AST nodes", nodes);
+    }
+    optimize(program, options);
+    return program;
+}
+
+
+// --incremental=DIR. each function's wasm is kept under a hash of its tokens and the signatures of the
+// functions it calls, so after an edit only the functions that changed are parsed, optimized and
+// generated again. the rest is read back and the module assembled around it
+struct Incremental {
+    string wasm;
+    unsigned long recompiled = 0, reused = 0;
+
+    static bool applies(const Options& options){
+        return !options.incremental.empty() && per_function(options);
+    }
+
+    Incremental(const char *source, const Options& options) : cache(options.incremental) {
+        Lexer lexer{source};
+        tokens = lexer();
+        split();
+
+        unordered_map<string, string> signatures;
+        for(auto& f : functions){
+            signatures[f.name] = f.signature;
+        }
+        string flags = fingerprint(options);
+
+        vector<Codegen::Generated> generated(functions.size());
+        atomic<unsigned long> hits = 0;
+        parallel_for(functions.size(), options.jobs, [&](unsigned long n){
+            Source& f = functions[n];
+            Sha256 hash;
+            hash << flags;
+            for(unsigned long i = f.begin; i < f.end; ++i){ // line numbers only matter to errors
+                hash << tokens[i].type + '\0' + tokens[i].value + '\0';
+            }
+            for(auto& callee : f.callees){
+                hash << callee + '\0' + (signatures.contains(callee) ? signatures.at(callee) : "?") + '\0';
+            }
+            string key = hash.hex();
+
+            auto entry = cache.get(key);
+            auto cached = entry ? read(*entry) : nullopt;
+            if(cached){
+                generated[n] = std::move(*cached);
+                ++hits;
+            }
+            else{
+                generated[n] = compile(f, options);
+                cache.put(key, write(generated[n]));
+            }
+        });
+        reused = hits;
+        recompiled = functions.size() - reused;
+
+        unsigned long main_parameters = 0;
+        for(auto& f : functions){
+            if(f.name == "main"){
+                main_parameters = f.parameters;
+            }
+        }
+        wasm = Codegen::assemble(generated, main_parameters);
+
+        if(options.incremental_report){
+            cerr << "incremental: " << recompiled << " functions recompiled, " << reused << " reused\n";
+        }
+    }
+
+    private:
+        struct Source {
+            string name, signature;     // name(a[],n)
+            unsigned long begin, end;   // its tokens
+            unsigned long parameters = 0;
+            set<string> callees;
+        };
+        vector<Token> tokens;
+        vector<Source> functions;
+        DiskCache cache;
+
+        void split(){
+            for(auto [begin, end] : function_ranges(tokens)){
+                Source f{tokens[begin].value, "", begin, end};
+                unsigned long i = begin;
+                for(; tokens[i].type != "{" && i < end; ++i){
+                    f.signature += tokens[i].value.empty() ? tokens[i].type : tokens[i].value;
+                    f.parameters += i > begin && tokens[i].type == "id";
+                }
+                for(; i < end; ++i){
+                    if(tokens[i].type == "id" && tokens[i + 1].type == "("){
+                        f.callees.insert(tokens[i].value);
+                    }
+                }
+                functions.push_back(std::move(f));
+            }
+        }
+
+        Codegen::Generated compile(Source& f, const Options& options){
+            return generate(Parser::function(&tokens[f.begin]), options);
+        }
+        // the number of strings and tables, each one's length and bytes, then the wasm
+        static string write(const Codegen::Generated& g){
+            string entry = to_string(g.data.size()) + "\n";
+            for(auto& bytes : g.data){
+                entry += to_string(bytes.size()) + "\n" + bytes;
+            }
+            return entry + g.wasm;
+        }
+
+        static optional<Codegen::Generated> read(const string& entry){
+            istringstream in{entry};
+            Codegen::Generated g;
+            unsigned long count, length;
+            if(!(in >> count) || in.get() != '\n'){
+                return {};
+            }
+            for(unsigned long i = 0; i < count; ++i){
+                if(!(in >> length) || in.get() != '\n'){
+                    return {};
+                }
+                string bytes(length, '\0');
+                if(!in.read(bytes.data(), length)){
+                    return {};
+                }
+                g.data.push_back(std::move(bytes));
+            }
+            g.wasm = entry.substr(in.tellg());
+            return g;
+        }
+};
+
+
+// --pipeline, lexing, parsing and generating at the same time on three threads for one big source
+//     lexer  -- token batches -->  parser  -- functions -->  codegen, writing the module out
+// the parser takes a function's tokens once its braces match. functions go through the passes and Codegen one at a time, so it needs per_function() options
+struct Pipeline {
+    static bool applies(const Options& options){
+        return options.pipeline && per_function(options) && !options.emit_c && !options.report;
+    }
+
+    Pipeline(const char *source, const Options& options, ostream& out){
+        Channel<vector<Token>> batches;
+        Channel<optional<Function>> functions;
+
+        thread lexer{[&]{
+            Lexer lexer{source};
+            while(!lexer.ended){
+                batches.push(lexer(1024));
+            }
+        }};
+        thread parser{[&]{
+            FunctionSplitter splitter;
+            while(true){
+                for(auto& token : batches.pop()){
+                    bool eof = token.type == "eof";
+                    if(splitter.add(std::move(token))){
+                        functions.push(splitter.take());
+                    }
+                    if(eof){
+                        functions.push({});
+                        return;
+                    }
+                }
+            }
+        }};
+
+        out << WEB_PAGE_PREAMBLE;
+        Codegen::Assembler assembler{out};
+        unsigned long main_parameters = 0;
+        while(auto f = functions.pop()){
+            if(f->name == "main"){
+                main_parameters = f->parameters.size();
+            }
+            assembler.add(generate(std::move(*f), options));
+        }
+        assembler.finish(main_parameters);
+        out << "\n" << WEB_PAGE_POSTAMBLE;
+
+        lexer.join();
+        parser.join();
+    }
+};
+
+
+// --stream, for sources too big to hold at once. the source is read and lexed a piece at a time, and
+// each function is generated and written out as soon as it is parsed, then dropped with its tokens.
+// all that is kept from one function to the next is what the module needs at the end, the strings
+// and tables for the data segment and main's parameter count, so memory goes with the biggest function
+struct Stream {
+    static bool applies(const Options& options){
+        return options.stream && per_function(options) && !options.emit_c;
+    }
+
+    Stream(istream& in, const Options& options, ostream& out) : options(options), assembler(out << WEB_PAGE_PREAMBLE) {
+        // pieces end at a newline outside of strings, no token spans one. the next piece carries on with
+        // whatever was read past it
+        enum { code, comment, text, escape } state = code;
+        string buffer;
+        unsigned long scanned = 0, cut = 0;
+        char block[1 << 16];
+        while(in.read(block, sizeof block) || in.gcount()){
+            buffer.append(block, in.gcount());
+            for(; scanned < buffer.size(); ++scanned){
+                char ch = buffer[scanned];
+                if(state == code && ch == '/' && scanned + 1 == buffer.size()){ // can't tell yet if // follows
+                    break;
+                }
+                if(state == code){
+                    state = ch == '"' ? text : ch == '/' && buffer[scanned + 1] == '/' ? comment : code;
+                }
+                else if(state == comment){
+                    state = ch == '\n' ? code : comment;
+                }
+                else if(state == text){
+                    state = ch == '\\' ? escape : ch == '"' ? code : text;
+                }
+                else{
+                    state = text;
+                }
+                if(state == code && ch == '\n'){
+                    cut = scanned + 1;
+                }
+            }
+            if(cut){
+                lex(buffer.substr(0, cut), false);
+                buffer.erase(0, cut);
+                scanned -= cut;
+                cut = 0;
+            }
+        }
+        lex(buffer, true);
+
+        assembler.finish(main_parameters);
+        out << "\n" << WEB_PAGE_POSTAMBLE;
+    }
+
+    private:
+        const Options& options;
+        Codegen::Assembler assembler;
+        FunctionSplitter splitter;
+        unsigned long line = 1, main_parameters = 0;
+
+        void lex(const string& piece, bool last){
+            Lexer lexer{piece.c_str()};
+            lexer.line = line;
+            auto tokens = lexer();
+            line = lexer.line;
+            if(!last){
+                tokens.pop_back();  // the piece's end isn't the source's
+            }
+            for(auto& token : tokens){
+                if(splitter.add(std::move(token))){
+                    Function f = splitter.take();
+                    if(f.name == "main"){
+                        main_parameters = f.parameters.size();
+                    }
+                    assembler.add(generate(std::move(f), options));
+                }
+            }
+        }
+};
+
+
+// --throughput, how fast the lexer, the parser and Codegen each go on Generator's programs, from 16KiB
+// up to --size four times bigger each step. as with --stream the source is lexed in batches, then
+// parsed and generated a function at a time, so hundreds of megabytes fit in memory, and each phase
+// is timed on its own. a size is compiled over until 4MiB have gone through, so the small ones aren't
+// all noise. a phase that scales linearly goes as fast at every size, how far off each is comes last.
+// the parser's heap allocations are counted too, by TimeReport's operator new. what is left of them
+// is the AST's own vectors, a shape that needs more than parse_budget a token fails the run
+struct Throughput {
+    // allocations per token. a parse can't do with much less than one per AST node, and every shape has
+    // 0.42 to 0.49 nodes a token. functions, with their parameter and statement vectors, needs 0.47 and
+    // the others 0.21 to 0.31. 0.6 leaves about a quarter over the worst, and is well under the 0.9 to
+    // 1.1 of the parser that copied every token
+    static constexpr double parse_budget = 0.6;
+
+    Throughput(const vector<string>& shapes, unsigned long largest, const Options& options){
+        bool over = false;
+        cout << left << setw(13) << "shape" << right << setw(11) << "bytes" << setw(12) << "tokens" << setw(12) << "nodes"
+             << setw(12) << "lex tok/s" << setw(11) << "lex MB/s" << setw(14) << "parse node/s"
+             << setw(14) << "gen node/s" << setw(11) << "gen MB/s" << setw(17) << "parse alloc/tok" << "\n";
+        for(auto& shape : shapes){
+            vector<Rates> rates;
+            for(unsigned long size = 16 << 10; size <= max(largest, 16ul << 10); size *= 4){
+                string source = Generator{shape, size}.source;
+                rates.push_back(measure(source, options.bounds_check));
+                Rates& r = rates.back();
+                cout << left << setw(13) << shape << right << setw(11) << source.size() << setw(12) << r.tokens
+                     << setw(12) << r.nodes << scientific << setprecision(3) << setw(12) << r.lex_tokens
+                     << fixed << setprecision(1) << setw(11) << r.lex_bytes / 1e6 << scientific << setprecision(3)
+                     << setw(14) << r.parse_nodes << setw(14) << r.gen_nodes << fixed << setprecision(1)
+                     << setw(11) << r.gen_bytes / 1e6 << setprecision(3) << setw(17) << r.parse_allocations
+                     << (r.parse_allocations > parse_budget ? "  over budget" : "") << defaultfloat << endl;
+                over |= r.parse_allocations > parse_budget;
+            }
+
+            // the slowest size's rate over the fastest's, 1 is perfectly linear
+            auto scaling = [&](double Rates::*rate){
+                auto [slowest, fastest] = minmax_element(rates.begin(), rates.end(), [&](Rates& a, Rates& b){ return a.*rate < b.*rate; });
+                return (*slowest).*rate / (*fastest).*rate;
+            };
+            double lex = scaling(&Rates::lex_tokens), parse = scaling(&Rates::parse_nodes), gen = scaling(&Rates::gen_nodes);
+            cout << shape << " scaling, slowest size over fastest: lex " << setprecision(2) << lex << ", parse " << parse
+                 << ", codegen " << gen << (min({lex, parse, gen}) >= 0.5 ? ", linear" : ", NOT linear") << "\n\n";
+        }
+        if(over){
+            cerr << "throughput: the parser allocated more than " << parse_budget << " times a token\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    private:
+        struct Rates {
+            unsigned long tokens = 0, nodes = 0;    // in one compile
+            double lex_tokens, lex_bytes, parse_nodes, gen_nodes, gen_bytes;   // per second
+            double parse_allocations;   // per token
+        };
+
+        static Rates measure(const string& source, bool bounds_check){
+            using clock = chrono::steady_clock;
+            clock::duration lexing{}, parsing{}, generating{};
+            unsigned long rounds = max(1ul, (4ul << 20) / source.size()), generated = 0, allocated = 0;
+            CountAllocations counted;
+            Rates r;
+            for(unsigned long round = 0; round < rounds; ++round){
+                r.tokens = r.nodes = 0;
+                Lexer lexer{source.c_str()};
+                FunctionSplitter splitter;
+                while(!lexer.ended){
+                    auto start = clock::now();
+                    auto tokens = lexer(1 << 16);
+                    lexing += clock::now() - start;
+                    r.tokens += tokens.size();
+                    for(auto& token : tokens){
+                        if(!splitter.add(std::move(token))){
+                            continue;
+                        }
+                        start = clock::now();
+                        unsigned long before = allocations;
+                        Function f = splitter.take();
+                        allocated += allocations - before;
+                        parsing += clock::now() - start;
+                        walk_statements(f.body, [&](Stmt&){ ++r.nodes; });
+                        walk(f.body, [&](Expr&){ ++r.nodes; });
+
+                        start = clock::now();
+                        auto g = Codegen::function(f, bounds_check);
+                        generating += clock::now() - start;
+                        generated += g.wasm.size();
+                    }
+                }
+            }
+            auto seconds = [](clock::duration d){ return chrono::duration<double>(d).count(); };
+            r.lex_tokens = rounds * r.tokens / seconds(lexing);
+            r.lex_bytes = rounds * source.size() / seconds(lexing);
+            r.parse_nodes = rounds * r.nodes / seconds(parsing);
+            r.gen_nodes = rounds * r.nodes / seconds(generating);
+            r.gen_bytes = generated / seconds(generating);
+            r.parse_allocations = (double)allocated / (rounds * r.tokens);
+            return r;
+        }
+};
+
+string compile(const char *source, const Options& options){
+    if(Incremental::applies(options)){
+        return Incremental{source, options}.wasm;
+    }
+    Program program = optimize(source, options);
+    optional<Codegen> gen;
+    phase(options, "codegen", [&]{ gen.emplace(program, options.bounds_check, options.jobs); });
+    if(options.report){
+        for(unsigned long i = 0; i < program.functions.size(); ++i){
+            options.report->functions.push_back({program.functions[i].name, gen->sizes[i].instructions, gen->sizes[i].locals});
+        }
+    }
+    return gen->wasm.str();
+}
+
+
+// the page, or the C with --emit-c
+string output(const char *source, const Options& options){
+    if(options.emit_c){
+        Program program = optimize(source, options);
+        string c;
+        phase(options, "codegen", [&]{ c = CBackend{program, options.bounds_check}.c.str(); });
+        return c;
+    }
+    return WEB_PAGE_PREAMBLE + compile(source, options) + "\n" + WEB_PAGE_POSTAMBLE;
+}
+
+// prints the page or the C, or with --run or --jit, runs the program right here. with --cache=DIR, what
+// was built before from the same source, options and compiler is printed straight out of DIR
+void build(const char *source, const Options& options){
+    if(!options.time_report.empty() && !options.report){ // measured on one thread, phases run where they're timed
+        TimeReport report;
+        Options timed = options;
+        timed.jobs = 1;
+        timed.report = &report;
+        build(source, timed);
+        report.print(cerr, options.time_report == "json");
+        return;
+    }
+
+    if(options.jit && !options.emit_c){
+        Program program = optimize(source, options);
+        phase(options, "run", [&]{ Jit{program, options.bounds_check}.run(); });
+        return;
+    }
+    if(options.run && !options.emit_c){
+        Program program = optimize(source, options);
+        phase(options, "run", [&]{ Interpreter{program, options.bounds_check}.run(); });
+        return;
+    }
+
+    if(Stream::applies(options)){ // these write the page as they go, so there is nothing to cache
+        istringstream in{source};
+        Stream{in, options, cout};
+        return;
+    }
+    if(Pipeline::applies(options)){
+        Pipeline{source, options, cout};
+        return;
+    }
+
+    bool reports = options.inline_report || options.specialize_report || options.bounds_check_report
+                || options.simd_report || options.incremental_report || options.report;   // a hit wouldn't print them
+    if(options.cache.empty() || reports){
+        string built = output(source, options);
+        phase(options, "output", [&]{ cout << built << flush; });
+        return;
+    }
+    DiskCache cache{options.cache, options.cache_limit};
+    Sha256 hash;
+    hash << fingerprint(options) << source;
+    string key = hash.hex();
+    if(auto built = cache.get(key)){
+        cout << *built;
+        return;
+    }
+    string built = output(source, options);
+    cache.put(key, built);
+    cout << built;
+}
+
+// string indent(string wasm){
+//         string res;
+//         const char *it = wasm.c_str();
+//         int level =  0;
+//         while(*it){
+//             res += *it;
+//             if('\n' == *it){
+//                 for(int i = 0; i < level; ++i){
+//                     res += ' ';
+//                 }
+//             }
+//             if('(' == *it){
+//                 level += 2;
+//             }
+//             if(')' == *it){
+//                 level -= 2;
+//             }
+//             ++it;
+//         }
+//         return res;
+// }
+
+
+
+
+
+void expression_run(const Options& options){
+    const char *source = R"(
+        main () {
+            print(1 + 1 - 2)  // 0
+            print(9 - 4 * 2)  // 1
             print(~0 + 3)  // 2
             print(428472393 & 1 + 2)  // 3
             print(-7 + 11)  // 4
@@ -605,19 +1971,12 @@ void expression_run(){
     }
     )"; 
 
-    Lexer lexer{source};
-    auto tokens = lexer();
-    Parser parser{tokens.data()};
-    Codegen gen{parser.program};
-
-    cout << WEB_PAGE_PREAMBLE;
-    cout << gen.wasm.str() << "\n";
-    cout << WEB_PAGE_POSTAMBLE;
+    build(source, options);
 
 }
 
 
-void hw2(){
+void hw2(const Options& options){
     const char *source = R"(
         main () {
             putch(65)   // 'H'
@@ -629,17 +1988,10 @@ void hw2(){
             putch(10)   // '\n'
         }
     )"; 
-    Lexer lexer{source};
-    auto tokens = lexer();
-    Parser parser{tokens.data()};
-    Codegen gen{parser.program};
-
-    cout << WEB_PAGE_PREAMBLE;
-    cout << gen.wasm.str() << "\n";
-    cout << WEB_PAGE_POSTAMBLE;
+    build(source, options);
 }
 
-void Variable_Run(){
+void Variable_Run(const Options& options){
     const char *source = R"(
         main() {
             let x
@@ -661,26 +2013,554 @@ void Variable_Run(){
             print(y[0])
         }
     )"; 
-    Lexer lexer{source};
-    auto tokens = lexer();
-    Parser parser{tokens.data()};
-    Codegen gen{parser.program};
+    build(source, options);
+
+
+}
+
+
+void inline_run(const Options& options){
+    const char *source = R"(
+        square(x) {
+            return x * x
+        }
+
+        sum(a[], n) {
+            let i, total
+            loop {
+                if i >= n {
+                    break
+                }
+                total = total + a[i]
+                i = i + 1
+            }
+            return total
+        }
+
+        fill(a[], n) {
+            let i, scratch[4]
+            loop {
+                if i >= n {
+                    break
+                }
+                scratch[i & 3] = square(i)
+                a[i] = scratch[i & 3]
+                i = i + 1
+            }
+        }
+
+        main() {
+            let x, v[8]
+            x = 3
+            print(square(x) + square(2))    // 13
+            fill(v, 8)
+            print(sum(v, 8))                // 140
+            print(sum(v, 3))                // 5
+        }
+    )";
+    build(source, options);
+}
 
-    cout << WEB_PAGE_PREAMBLE;
-    cout << gen.wasm.str() << "\n";
-    cout << WEB_PAGE_POSTAMBLE;
 
+// expressions nested a million deep, which build in every mode because nothing that walks them, from the
+// parser through the passes to each backend, recurses. each is its own function, V8 won't take one over
+// 7.6MB, and indexing goes half as deep as it makes 8 bytes a level. the last is a loop for licm and the
+// vectorizer to work on, with an initializer, each a quarter as deep as the loop is generated twice.
+// prints 30, 31, 500000, 1000000 twice, 32, 33 and 34
+void nesting_run(const Options& options){
+    const unsigned long depth = 1000000;
+    auto repeat = [](const string& text, unsigned long times){
+        string repeated;
+        for(unsigned long i = 0; i < times; ++i){
+            repeated += text;
+        }
+        return repeated;
+    };
+    vector<string> deep = {
+        string(depth, '(') + "30" + string(depth, ')'),
+        string(depth, '-') + "31",
+        repeat("-~", depth / 2) + "0",
+        repeat("1 + (", depth - 1) + "1" + string(depth - 1, ')'),
+        "0" + repeat(" + 1", depth),
+        repeat("a[", depth / 2) + "0" + string(depth / 2, ']') + " + 32",
+        repeat("identity(", depth) + "33" + string(depth, ')'),
+    };
+    string source = "identity(x) {\n    return x\n}\n\n", main = "main() {\n";
+    for(unsigned long i = 0; i < deep.size(); ++i){
+        source += "deep" + to_string(i) + "(x) {\n    let a[2]\n    return " + deep[i] + "\n}\n\n";
+        main += "    print(deep" + to_string(i) + "(0))\n";
+    }
+    string negated = repeat("-", depth / 4);
+    source += "deep7(x) {\n    let i, a[4], b[4] = {" + negated + "34, 34, 34, 34}\n    loop {\n"
+              "        if i >= 4 {\n            break\n        }\n"
+              "        a[i] = " + negated + "b[i] + " + negated + "x\n        i = i + 1\n    }\n    return a[3]\n}\n\n";
+    main += "    print(deep7(0))\n";
+    source += main + "}\n";
+    build(source.c_str(), options);
+}
+
+// a byte count for --size, with an optional K, M or G after it
+unsigned long parse_size(const string& arg){
+    unsigned long end, size = stoul(arg, &end);
+    string unit = arg.substr(end);
+    if(unit.empty() || unit == "K" || unit == "M" || unit == "G"){
+        return size << (unit.empty() ? 0 : unit == "K" ? 10 : unit == "M" ? 20 : 30);
+    }
+    cerr << "a size is a number of bytes, with K, M or G after it if you like, not " << arg << "\n";
+    exit(EXIT_FAILURE);
+}
 
+// sets what one command line flag asks for
+void parse_option(Options& options, const string& arg){
+    if(arg == "--inline"){
+        options.inline_functions = true;
+    }
+    else if(arg.starts_with("--inline-budget=")){
+        options.inline_functions = true;
+        options.inline_budget = stoul(arg.substr(16));
+    }
+    else if(arg == "--inline-report"){
+        options.inline_report = true;
+    }
+    else if(arg == "--fold"){
+        options.fold = true;
+    }
+    else if(arg == "-O0" || arg == "-O1" || arg == "-O2" || arg == "-O3"){
+        // -O1 folds, -O2 inlines and optimizes loops too, -O3 also specializes and vectorizes. what
+        // a level leaves off can still be turned on with its own flag
+        int level = arg[2] - '0';
+        options.fold |= level >= 1;
+        options.inline_functions |= level >= 2;
+        options.licm |= level >= 2;
+        options.strength_reduce |= level >= 2;
+        options.specialize |= level >= 3;
+        options.simd |= level >= 3;
+    }
+    else if(arg == "--specialize"){
+        options.specialize = true;
+    }
+    else if(arg.starts_with("--specialize-limit=")){
+        options.specialize = true;
+        options.specialize_limit = stoul(arg.substr(19));
+    }
+    else if(arg == "--specialize-report"){
+        options.specialize_report = true;
+    }
+    else if(arg == "--strength-reduce"){
+        options.strength_reduce = true;
+    }
+    else if(arg == "--licm"){
+        options.licm = true;
+    }
+    else if(arg == "--bounds-check"){
+        options.bounds_check = true;
+    }
+    else if(arg == "--bounds-check-report"){
+        options.bounds_check = true;
+        options.bounds_check_report = true;
+    }
+    else if(arg == "--simd"){
+        options.simd = true;
+    }
+    else if(arg == "--simd-report"){
+        options.simd = true;
+        options.simd_report = true;
+    }
+    else if(arg == "--run"){
+        options.run = true;
+    }
+    else if(arg == "--jit"){
+        options.jit = true;
+    }
+    else if(arg == "--emit-c"){
+        options.emit_c = true;
+    }
+    else if(arg.starts_with("--incremental=")){
+        options.incremental = arg.substr(14);
+    }
+    else if(arg == "--incremental-report"){
+        options.incremental_report = true;
+    }
+    else if(arg.starts_with("--cache=")){
+        options.cache = arg.substr(8);
+    }
+    else if(arg.starts_with("--cache-limit=")){
+        options.cache_limit = stoul(arg.substr(14));
+    }
+    else if(arg == "--time-report" || arg == "--time-report=json"){
+        options.time_report = arg == "--time-report" ? "text" : "json";
+    }
+    else if(arg == "--stream"){
+        options.stream = true;
+    }
+    else if(arg == "--pipeline"){
+        options.pipeline = true;
+    }
+    else if(arg.starts_with("--jobs=")){
+        options.jobs = max(1ul, stoul(arg.substr(7)));
+    }
+    else{
+        cerr << "unknown option " << arg << "\n";
+        exit(EXIT_FAILURE);
+    }
 }
 
 
-int main(void) {
+// --quality, how good the code is at each optimization level rather than how fast it is made. every
+// kernel is built at -O0 to -O3 on top of the other flags given and its wasm run under node with
+// webpage/run.js, once as it is for the output and the time main takes, and once with a counter added
+// to every straight run of instructions for how many it executes, an i32x4 op being one. that is shown
+// with the size of the module and the time. output that differs from -O0's is a miscompile and fails,
+// and so does a level running more instructions than a lower one (bytes may grow, inlining and simd
+// trade them for speed). with --baseline=FILE instructions and module bytes more than --threshold
+// percent (2 unless given) worse than recorded there fail too, --update-baseline records this run
+// instead. wall time is too noisy on a shared machine to hold anything to, it is only shown
+struct Quality {
+    static inline const vector<string> levels = {"-O0", "-O1", "-O2", "-O3"};
+
+    Quality(const vector<string>& kernels, const Options& options, const string& baseline, bool update, double threshold)
+        : threshold(threshold) {
+        if(kernels.empty()){
+            cerr << "--quality needs kernels to build, like benchmarks/*.src\n";
+            exit(EXIT_FAILURE);
+        }
+        if(!baseline.empty() && !update){
+            read(baseline);
+        }
+
+        cout << left << setw(14) << "kernel" << setw(6) << "level" << right << setw(18) << "wasm instructions"
+             << setw(14) << "module bytes" << setw(11) << "run ms" << "   vs baseline\n";
+        for(auto& path : kernels){
+            ifstream file{path, ios::binary};
+            if(!file){
+                cerr << "couldn't open " << path << "\n";
+                exit(EXIT_FAILURE);
+            }
+            stringstream source;
+            source << file.rdbuf();
+            string kernel = filesystem::path{path}.stem().string(), expected;
+            unsigned long fewest = ULONG_MAX;   // instructions at the best level below this one
+            string fewest_level;
+
+            for(auto& level : levels){
+                Options o = options;
+                parse_option(o, level);
+                Result r = measure(source.str().c_str(), o);
+                if(level == levels[0]){
+                    expected = r.output;
+                }
+                cout << left << setw(14) << kernel << setw(6) << level << right << setw(18) << r.instructions
+                     << setw(14) << r.module_bytes << fixed << setprecision(2) << setw(11) << 1000 * r.seconds
+                     << defaultfloat << "   " << compare(kernel + " " + level, r) << "\n";
+                if(r.output != expected){
+                    cout << "MISCOMPILED, the output differs from " << levels[0] << "'s\n";
+                    failed = true;
+                }
+                if(r.instructions > fewest){
+                    cout << "SLOWER, runs more instructions than " << fewest_level << "\n";
+                    failed = true;
+                }
+                if(r.instructions < fewest){
+                    fewest = r.instructions;
+                    fewest_level = level;
+                }
+                results.push_back({kernel + " " + level, r});
+            }
+        }
+
+        if(update){
+            ofstream file{baseline};
+            file << "# kernel level instructions module_bytes, written by --quality --update-baseline\n";
+            for(auto& [name, r] : results){
+                file << name << " " << r.instructions << " " << r.module_bytes << "\n";
+            }
+            if(!file){
+                cerr << "couldn't write " << baseline << "\n";
+                exit(EXIT_FAILURE);
+            }
+        }
+        if(failed){
+            cerr << "quality: worse than the baseline or a lower level, or miscompiled\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    private:
+        struct Result {
+            unsigned long instructions = 0, module_bytes = 0;
+            double seconds = 0;
+            string output;
+        };
+
+        double threshold;
+        bool failed = false;
+        unordered_map<string, pair<unsigned long, unsigned long>> recorded;     // instructions, module bytes
+        vector<pair<string, Result>> results;
+
+        static Result measure(const char *source, const Options& options){
+            Result r;
+            string wat = compile(source, options);
+            r.module_bytes = wat.size();
+            string timed = node(wat, "--time", r.output), ignored;
+            string executed = node(counted(wat), "--count", ignored);
+            if(sscanf(timed.c_str(), "main ran for %lf ms", &r.seconds) != 1
+                    || sscanf(executed.c_str(), "executed %lu instructions", &r.instructions) != 1){
+                cerr << "webpage/run.js didn't report what --quality asked of it:\n" << timed << executed;
+                exit(EXIT_FAILURE);
+            }
+            r.seconds /= 1000;
+            return r;
+        }
+
+        // runs a module with webpage/run.js and flags, what the kernel prints goes in printed and what
+        // run.js reports on stderr is returned
+        static string node(const string& wat, const string& flags, string& printed){
+            string base = (filesystem::temp_directory_path() / ("quality." + to_string(getpid()))).string();
+            ofstream{base + ".wat", ios::binary} << wat;
+            string command = "node webpage/run.js '" + base + ".wat' " + flags + " > '" + base + ".out' 2> '" + base + ".err'";
+            bool ran = system(command.c_str()) == 0;
+            auto read = [](const string& path){
+                ifstream file{path, ios::binary};
+                stringstream contents;
+                contents << file.rdbuf();
+                return contents.str();
+            };
+            printed = read(base + ".out");
+            string reported = read(base + ".err");
+            for(auto extension : {".wat", ".out", ".err"}){
+                filesystem::remove(base + extension);
+            }
+            if(!ran){
+                cerr << "couldn't run a kernel under node, --quality runs webpage/run.js from where it is started\n" << reported;
+                exit(EXIT_FAILURE);
+            }
+            return reported;
+        }
+
+        // wat with what it executes added up in $rt:executed, for the exported executed to give back.
+        // Codegen writes one instruction a line, so a straight run of them from one control instruction
+        // to the next is counted by a single add at its start. block, loop, else and end only mark where
+        // branches go and aren't counted themselves
+        static string counted(const string& wat){
+            static const unordered_set<string> control{"block", "loop", "if", "else", "end", "br", "br_if", "br_table", "return", "unreachable"};
+            static const unordered_set<string> markers{"block", "loop", "else", "end"};
+            vector<string> lines, opcodes;  // an empty opcode for what isn't an instruction
+            vector<bool> closes;            // the line ending a function
+            istringstream in{wat};
+            bool in_function = false;
+            for(string line; getline(in, line); ){
+                istringstream words{line};
+                string first;
+                words >> first;
+                if(first == "(func"){
+                    in_function = true;
+                }
+                closes.push_back(first == ")" && in_function);
+                if(closes.back()){
+                    in_function = false;
+                }
+                lines.push_back(line);
+                opcodes.push_back(in_function && !first.starts_with("(") && !first.starts_with(";;") ? first : "");
+            }
+
+            stringstream out;
+            bool starts = true;     // the next instruction begins a run
+            for(unsigned long i = 0; i < lines.size(); ++i){
+                if(opcodes[i].empty()){
+                    if(lines[i] == ")"){ // the module's end
+                        out << "(global $rt:executed (mut i64) (i64.const 0))\n";
+                        out << "(func $rt:executed (result i64)\nglobal.get $rt:executed\n         )\n";
+                        out << "(export \"executed\" (func $rt:executed))\n";
+                    }
+                    out << lines[i] << "\n";
+                    starts = starts || lines[i].starts_with("(func");
+                    continue;
+                }
+                if(starts){
+                    unsigned long run = 0;
+                    for(unsigned long j = i; !closes[j]; ++j){
+                        run += !opcodes[j].empty() && !markers.contains(opcodes[j]);
+                        if(control.contains(opcodes[j])){
+                            break;
+                        }
+                    }
+                    if(run){
+                        out << "global.get $rt:executed\ni64.const " << run << "\ni64.add\nglobal.set $rt:executed\n";
+                    }
+                }
+                out << lines[i] << "\n";
+                starts = control.contains(opcodes[i]);
+            }
+            return out.str();
+        }
+
+        void read(const string& baseline){
+            ifstream file{baseline};
+            if(!file){
+                cerr << "couldn't open " << baseline << ", --update-baseline makes one\n";
+                exit(EXIT_FAILURE);
+            }
+            for(string line; getline(file, line); ){
+                istringstream fields{line};
+                string kernel, level;
+                unsigned long instructions, bytes;
+                if(!line.starts_with("#") && fields >> kernel >> level >> instructions >> bytes){
+                    recorded[kernel + " " + level] = {instructions, bytes};
+                }
+            }
+        }
+
+        // the change from the baseline, in percent
+        string compare(const string& name, const Result& r){
+            auto it = recorded.find(name);
+            if(it == recorded.end()){
+                return recorded.empty() ? "" : "not in the baseline";
+            }
+            auto change = [](unsigned long now, unsigned long then){ return 100.0 * ((double)now - then) / max(then, 1ul); };
+            double instructions = change(r.instructions, it->second.first), bytes = change(r.module_bytes, it->second.second);
+            stringstream text;
+            text << showpos << fixed << setprecision(1) << instructions << "% instructions, " << bytes << "% bytes";
+            if(instructions > threshold || bytes > threshold){
+                text << "  REGRESSION";
+                failed = true;
+            }
+            return text.str();
+        }
+};
+
+int main(int argc, char **argv) {
+    Options options;
+    const char *path = nullptr;
+    vector<string> paths;
+    optional<string> serve;
+    bool batch = false;
+    string manifest, out;
+    optional<string> generate, throughput;
+    optional<unsigned long> size;
+    bool quality = false, update_baseline = false, nesting = false;
+    string baseline;
+    double threshold = 2;
+
+    for(int i = 1; i < argc; ++i){
+        string arg = argv[i];
+        if(arg == "--serve" || arg.starts_with("--serve=")){
+            serve = arg.substr(min(arg.size(), 8ul));
+        }
+        else if(arg == "--batch"){
+            batch = true;
+        }
+        else if(arg.starts_with("--manifest=")){
+            batch = true;
+            manifest = arg.substr(11);
+        }
+        else if(arg.starts_with("--out=")){
+            out = arg.substr(6);
+        }
+        else if(arg.starts_with("--generate=")){
+            generate = arg.substr(11);
+        }
+        else if(arg == "--throughput" || arg.starts_with("--throughput=")){
+            throughput = arg.substr(min(arg.size(), 13ul));
+        }
+        else if(arg.starts_with("--size=")){
+            size = parse_size(arg.substr(7));
+        }
+        else if(arg == "--quality"){
+            quality = true;
+        }
+        else if(arg == "--nesting"){ // nesting_run's program rather than Variable_Run's, for test.bash
+            nesting = true;
+        }
+        else if(arg.starts_with("--baseline=")){
+            baseline = arg.substr(11);
+        }
+        else if(arg == "--update-baseline"){
+            update_baseline = true;
+        }
+        else if(arg.starts_with("--threshold=")){
+            threshold = stod(arg.substr(12));
+        }
+        else if(arg[0] == '-'){
+            parse_option(options, arg);
+        }
+        else{
+            path = argv[i];
+            paths.push_back(path);
+        }
+    }
+
+    if(generate){
+        cout << Generator{*generate, size.value_or(1 << 20)}.source;
+        return 0;
+    }
+
+    if(throughput){ // every shape, unless one is named
+        Throughput{throughput->empty() ? Generator::shapes : vector<string>{*throughput}, size.value_or(64 << 20), options};
+        return 0;
+    }
+
+    if(quality){ // the kernels are the paths given
+        Quality{paths, options, baseline, update_baseline, threshold};
+        return 0;
+    }
+
+    if(batch){ // the files are compiled side by side, each one on a single thread
+        if(options.run || options.jit){
+            cerr << "--batch builds pages or C, it can't --run or --jit\n";
+            exit(EXIT_FAILURE);
+        }
+        Options each = options;
+        each.jobs = 1;
+        return Batch{paths, manifest, out, options.emit_c ? ".c" : ".html"}(options.jobs, [&](const string& source){
+            return output(source.c_str(), each);
+        });
+    }
+
+    if(serve){ // each request brings its own flags, the server's only set how many compile at once
+        Server server{options.jobs, [](const string& source, const vector<string>& flags){
+            Options options;
+            for(auto& flag : flags){
+                parse_option(options, flag);
+            }
+            build(source.c_str(), options);
+        }};
+        if(serve->empty()){
+            server.serve(STDIN_FILENO, STDOUT_FILENO);
+        }
+        else{
+            server.listen(*serve);
+        }
+        return 0;
+    }
+
+    if(path){
+        ifstream file{path, ios::binary};
+        if(!file){
+            cerr << "couldn't open " << path << "\n";
+            exit(EXIT_FAILURE);
+        }
+        if(Stream::applies(options) && !options.run && !options.jit && options.time_report.empty()){ // without reading it all in first
+            Stream{file, options, cout};
+            return 0;
+        }
+        stringstream source;
+        source << file.rdbuf();
+        build(source.str().c_str(), options);
+        return 0;
+    }
     
-    //hw2();
+    //hw2(options);
+
+    //expression_run(options);
 
-    //expression_run();
+    //inline_run(options);
+
+    if(nesting){
+        nesting_run(options);
+        return 0;
+    }
 
-    Variable_Run();
+    Variable_Run(options);
 
     return 0;
 }
\ No newline at end of file
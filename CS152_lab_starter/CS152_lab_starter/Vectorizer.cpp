@@ -0,0 +1,198 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+
+// finds element-wise loops over local arrays for --simd
+//     loop {
+//         if i >= n { break }             // or n <= i, i == n
+//         a[i] = b[i] + c[i] ^ 3          // any number of these
+//         i = i + 1
+//     }
+// every index is exactly i, so each lane only touches its own element, and the arrays are distinct
+// stack arrays that can't overlap. the operators have i32x4 forms: + - * & | ^, << and >> by a
+// loop-invariant amount, unary - and ~. Codegen runs such a loop four elements at a time first and
+// finishes the remainder with the scalar loop, which is left unchanged. with only_proven, a loop with
+// an access that still needs a bounds check stays scalar, the vector loop doesn't check
+struct Vectorizer {
+    unsigned long vectorized = 0;
+    stringstream report;
+
+    Vectorizer(Program& program, bool only_proven = false) : only_proven(only_proven) {
+        for(auto& f : program.functions){
+            scopes = {{}};
+            for(auto& p : f.parameters){
+                scopes.back()[p.name] = p.is_array() ? Kind::parameter_array : Kind::scalar;
+            }
+            optimize(f.body);
+        }
+        report << "vectorized " << vectorized << " loops\n";
+    }
+
+    private:
+        enum class Kind { scalar, local_array, parameter_array };
+        vector<unordered_map<string, Kind>> scopes;
+        bool only_proven;
+
+        const Kind *lookup(const string& name){
+            for(auto it = scopes.rbegin(); it != scopes.rend(); ++it){
+                if(it->contains(name)){
+                    return &(*it)[name];
+                }
+            }
+            return nullptr;
+        }
+
+        void optimize(Block& b){
+            scopes.push_back({});
+            for(auto& s : b.body){
+                walk_inlined(s, [&](InlinedCall& call){ optimize(call); });
+                if(auto *let = get_if<Let>(&s)){
+                    for(auto& dec : let->declarations){
+                        scopes.back()[dec.name] = dec.array_size ? Kind::local_array
+                                                : dec.pointer ? Kind::parameter_array : Kind::scalar;
+                    }
+                }
+                else if(auto *block = get_if<Block>(&s)){
+                    optimize(*block);
+                }
+                else if(auto *branch = get_if<If>(&s)){
+                    optimize(branch->if_body);
+                    optimize(branch->else_body);
+                }
+                else if(auto *loop = get_if<Loop>(&s)){
+                    if(vectorizable(*loop)){
+                        loop->vectorized = true;
+                        ++vectorized;
+                    }
+                    else{
+                        optimize(loop->body);
+                    }
+                }
+            }
+            scopes.pop_back();
+        }
+
+        // an inlined body's local arrays are its own stack arrays, as a function's are
+        void optimize(InlinedCall& call){
+            auto outer = std::move(scopes);
+            scopes = {{}};
+            for(auto& p : call.parameters){
+                scopes.back()[p.name] = p.is_array() ? Kind::parameter_array : Kind::scalar;
+            }
+            optimize(call.body);
+            scopes = std::move(outer);
+        }
+
+        bool vectorizable(Loop& loop){
+            auto& body = loop.body.body;
+            if(body.size() < 3){
+                return false;
+            }
+
+            // i = i + 1 last
+            auto *step = get_if<Assign>(&body.back());
+            auto *counter = step ? get_if<VariableAccess>(&step->lhs) : nullptr;
+            auto *add = step ? get_if<BinaryOperation>(&step->rhs) : nullptr;
+            if(!counter || !add || add->opcode != "+" || Folder::constant(add->args[1]) != 1){
+                return false;
+            }
+            auto *self = get_if<VariableAccess>(&add->args[0]);
+            const Kind *kind = lookup(counter->name);
+            if(!self || self->name != counter->name || !kind || *kind != Kind::scalar){
+                return false;
+            }
+            const string& i = counter->name;
+
+            // the exit test first
+            Expr *bound = guard(body.front(), i);
+            if(!bound || !invariant(*bound, i)){
+                return false;
+            }
+
+            // element-wise stores in between
+            for(unsigned long k = 1; k + 1 < body.size(); ++k){
+                auto *store = get_if<Assign>(&body[k]);
+                auto *dest = store ? get_if<ArrayAccess>(&store->lhs) : nullptr;
+                if(!dest || !element(*dest, i) || !lanes(store->rhs, i)){
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static Expr *guard(Stmt& s, const string& i){
+            auto *branch = get_if<If>(&s);
+            if(!branch || branch->if_body.body.size() != 1 || !holds_alternative<Break>(branch->if_body.body[0])
+                    || !branch->else_body.body.empty()){
+                return nullptr;
+            }
+            auto *cmp = get_if<BinaryOperation>(&branch->cond);
+            if(!cmp){
+                return nullptr;
+            }
+            auto *lhs = get_if<VariableAccess>(&cmp->args[0]);
+            auto *rhs = get_if<VariableAccess>(&cmp->args[1]);
+            if(lhs && lhs->name == i && (cmp->opcode == ">=" || cmp->opcode == "==")){
+                return &cmp->args[1];
+            }
+            if(rhs && rhs->name == i && (cmp->opcode == "<=" || cmp->opcode == "==")){
+                return &cmp->args[0];
+            }
+            return nullptr;
+        }
+
+        // the only assignment in the body is to i, and the stores go to arrays
+        bool invariant(Expr& e, const string& i){
+            if(holds_alternative<IntegerLiteral>(e)){
+                return true;
+            }
+            auto *var = get_if<VariableAccess>(&e);
+            const Kind *kind = var ? lookup(var->name) : nullptr;
+            return kind && *kind == Kind::scalar && var->name != i;
+        }
+
+        bool element(ArrayAccess& aa, const string& i){
+            auto *index = get_if<VariableAccess>(&aa.index[0]);
+            const Kind *kind = lookup(aa.name);
+            return index && index->name == i && kind && *kind == Kind::local_array && (aa.in_bounds || !only_proven);
+        }
+
+        // on a stack of its own, an element-wise expression can nest as deep as any other
+        bool lanes(Expr& root, const string& i){
+            static const unordered_set<string> unary{"+", "-", "~"};
+            static const unordered_set<string> binary{"+", "-", "*", "&", "|", "^"};
+            vector<Expr*> stack{&root};
+            while(!stack.empty()){
+                Expr& e = *stack.back();
+                stack.pop_back();
+                if(auto *aa = get_if<ArrayAccess>(&e)){
+                    if(!element(*aa, i)) return false;
+                }
+                else if(auto *unop = get_if<UnaryOperation>(&e)){
+                    if(!unary.contains(unop->opcode)) return false;
+                    stack.push_back(&unop->lhs[0]);
+                }
+                else if(auto *binop = get_if<BinaryOperation>(&e)){
+                    if(binop->opcode == "<<" || binop->opcode == ">>"){ // the shift count stays a scalar
+                        if(!invariant(binop->args[1], i)) return false;
+                    }
+                    else if(!binary.contains(binop->opcode)){
+                        return false;
+                    }
+                    else{
+                        stack.push_back(&binop->args[1]);
+                    }
+                    stack.push_back(&binop->args[0]);
+                }
+                else if(!invariant(e, i)){
+                    return false;
+                }
+            }
+            return true;
+        }
+};
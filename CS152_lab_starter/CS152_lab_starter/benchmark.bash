@@ -0,0 +1,27 @@
+set -e
+# times every program in benchmarks/ four ways: the bytecode interpreter (--run),
+# the x86-64 jit (--jit), the C from --emit-c built with clang -O3, and the generated wasm
+# under node, which needs node on the path
+clang++ \
+    -O3 -std=c++20 -pthread -ferror-limit=2 \
+    -Wall -Wno-unqualified-std-cast-call -Wno-logical-op-parentheses \
+    -DCOMPILER_SOURCES="\"$(cat *.cpp webpage/boilerplate.hpp | shasum -a 256 | cut -c1-64)\"" \
+    Variables.cpp AST.cpp Lexer.cpp -o bench_temp
+
+for program in benchmarks/*.src; do
+    echo "== $program"
+    echo "-- interpreter"
+    time ./bench_temp --run "$program"
+    echo "-- jit"
+    time ./bench_temp --jit "$program"
+    echo "-- c"
+    ./bench_temp --emit-c "$program" > bench_temp.c
+    clang -O3 -std=c99 bench_temp.c -o bench_temp_c
+    time ./bench_temp_c
+    echo "-- wasm in node"
+    ./bench_temp "$program" > bench_temp.html
+    time node webpage/run.js bench_temp.html --time
+done
+
+rm bench_temp bench_temp.html bench_temp.c bench_temp_c
+echo "Ran Benchmarks"
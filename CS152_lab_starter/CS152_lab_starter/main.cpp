@@ -8,36 +8,21 @@ using namespace std;
 int main() {
     string wasm =R"(
 (module
-  (import "env" "print" (func $print (param i32)))
-  (import "env" "putch" (func $putch (param i32)))
+  (import "env" "write" (func $write (param i32 i32)))
+  (memory 1)
+  (data (i32.const 0) "Hello World")
   
   (func $main (result i32)
-    i32.const 72
-    call $putch
-    i32.const 101
-    call $putch
-    i32.const 108
-    call $putch
-    i32.const 108
-    call $putch
-    i32.const 111
-    call $putch
-    i32.const 32
-    call $putch
-    i32.const 87
-    call $putch
-    i32.const 111
-    call $putch
-    i32.const 114
-    call $putch
-    i32.const 108
-    call $putch
-    i32.const 100
-    call $putch
+    i32.const 0
+    i32.const 11
+    call $write
 
     i32.const 0
 )
+  (func $flush)
   (export "main" (func $main))
+  (export "flush" (func $flush))
+  (export "memory" (memory 0))
 ))";
     cout << WEB_PAGE_PREAMBLE;
     cout << wasm << "\n";
@@ -0,0 +1,15 @@
+set -e
+# how good the generated code is: every program in benchmarks/ built at -O0 to -O3 and run under node,
+# the wasm instructions it executed, module size and run time for each. fails when one is more than 2%
+# worse than benchmarks/quality.baseline, or when a level runs more instructions than a lower one.
+# after a change that is meant to move the numbers, pass --update-baseline to record them
+clang++ \
+    -O3 -std=c++20 -pthread -ferror-limit=2 \
+    -Wall -Wno-unqualified-std-cast-call -Wno-logical-op-parentheses \
+    -DCOMPILER_SOURCES="\"$(cat *.cpp webpage/boilerplate.hpp | shasum -a 256 | cut -c1-64)\"" \
+    Variables.cpp AST.cpp Lexer.cpp -o bench_temp
+
+./bench_temp --quality benchmarks/*.src --baseline=benchmarks/quality.baseline "$@" || { rm bench_temp; exit 1; }
+
+rm bench_temp
+echo "Ran Quality Benchmarks"
@@ -1,9 +1,10 @@
 set -e
 clear
 clang++ \
-    -O3 -std=c++20 -ferror-limit=2 \
+    -O3 -std=c++20 -pthread -ferror-limit=2 \
     -fsanitize=address \
     -Wall -Wno-unqualified-std-cast-call -Wno-logical-op-parentheses \
+    -DCOMPILER_SOURCES="\"$(cat *.cpp webpage/boilerplate.hpp | shasum -a 256 | cut -c1-64)\"" \
     Variables.cpp AST.cpp Lexer.cpp -o temp
 ./temp > index.html
 rm temp
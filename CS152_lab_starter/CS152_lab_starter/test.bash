@@ -0,0 +1,65 @@
+set -e
+# every program in tests/ built at each -O level, and with --bounds-check, then run four ways: the
+# wasm page under node, the interpreter (--run), the jit (--jit) and the C from --emit-c. each run
+# has to print what tests/NAME.expect has. a program that stops on a trap ends with a line "trap",
+# the message is left out as the backends word some of them differently. a program that goes out of
+# bounds, which only traps with --bounds-check, has what it prints then in tests/NAME.checked.expect
+clang++ \
+    -O3 -std=c++20 -pthread -ferror-limit=2 \
+    -Wall -Wno-unqualified-std-cast-call -Wno-logical-op-parentheses \
+    -DCOMPILER_SOURCES="\"$(cat *.cpp webpage/boilerplate.hpp | shasum -a 256 | cut -c1-64)\"" \
+    Variables.cpp AST.cpp Lexer.cpp -o test_temp
+
+failed=0
+run(){ # stdout, then "trap" if it trapped
+    if "$@" > test_temp.out 2> test_temp.err; then
+        cat test_temp.out
+    else
+        cat test_temp.out
+        grep -qE "^trap: |RuntimeError: " test_temp.err && echo trap || echo "crashed: $(tail -1 test_temp.err)"
+    fi
+}
+for program in tests/*.src; do
+    for flags in "-O0" "-O1" "-O2" "-O3" "-O3 --bounds-check"; do
+        expected="${program%.src}.expect"
+        if [[ $flags == *--bounds-check* && -f "${program%.src}.checked.expect" ]]; then
+            expected="${program%.src}.checked.expect"
+        fi
+        ./test_temp $flags "$program" > test_temp.html
+        ./test_temp $flags --emit-c "$program" > test_temp.c
+        clang -O1 -std=c99 test_temp.c -o test_temp_c
+        for way in "node webpage/run.js test_temp.html" "./test_temp $flags --run $program" "./test_temp $flags --jit $program" "./test_temp_c"; do
+            if ! run $way | diff -q - "$expected" > /dev/null; then
+                echo "FAILED $program $flags: $way"
+                run $way | diff - "$expected" | head -5 || true
+                failed=1
+            fi
+        done
+    done
+done
+
+# nesting_run, what --nesting builds without a file, nests a million deep. V8 takes minutes over that page
+# and C compilers over the C, so it runs natively, and its C only has to come out
+for flags in "-O0" "-O3 --bounds-check"; do
+    for way in "./test_temp $flags --nesting --run" "./test_temp $flags --nesting --jit"; do
+        if [ "$(run $way | tr '\n' ' ')" != "30 31 500000 1000000 1000000 32 33 34 " ]; then
+            echo "FAILED nesting_run $flags: $way"
+            failed=1
+        fi
+    done
+    if ! ./test_temp $flags --nesting --emit-c > /dev/null; then
+        echo "FAILED nesting_run $flags: --emit-c"
+        failed=1
+    fi
+done
+
+# the parser's allocations a token, held to Throughput's parse_budget. the smallest size is enough
+# for that and takes seconds, throughput.bash goes on up to 256MiB
+if ! ./test_temp --throughput --size=16K > /dev/null; then
+    echo "FAILED parse budget: --throughput --size=16K"
+    failed=1
+fi
+
+rm -f test_temp test_temp.html test_temp.c test_temp_c test_temp.out test_temp.err
+[ $failed = 0 ] || exit 1
+echo "Ran Tests"
@@ -0,0 +1,15 @@
+set -e
+# how fast the compiler itself goes: lexer tokens/s, parser nodes/s and codegen bytes/s on generated
+# programs of every shape, from 16KiB up to 256MiB. ./bench_temp --generate=SHAPE --size=BYTES prints
+# one of the programs, to try on anything else. fails if the parser allocates more per token than
+# Throughput's parse_budget
+clang++ \
+    -O3 -std=c++20 -pthread -ferror-limit=2 \
+    -Wall -Wno-unqualified-std-cast-call -Wno-logical-op-parentheses \
+    -DCOMPILER_SOURCES="\"$(cat *.cpp webpage/boilerplate.hpp | shasum -a 256 | cut -c1-64)\"" \
+    Variables.cpp AST.cpp Lexer.cpp -o bench_temp
+
+./bench_temp --throughput --size=256M || { rm bench_temp; exit 1; }
+
+rm bench_temp
+echo "Ran Throughput Benchmarks"
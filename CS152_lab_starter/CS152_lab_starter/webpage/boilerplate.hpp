@@ -175,25 +175,30 @@ static const char *WEB_PAGE_POSTAMBLE = R"(
                 const wasm_module = wabt.parseWat('source_code.wat', wasm_text)
                 const wasm_binary = wasm_module.toBinary({}).buffer
 
+                // print and putch are buffered in the module, which hands over its output a chunk at a time
+                let memory = null
                 const imports = {
                     env: {
-                        print: (value) => {
-                            result.textContent += `${value}\n`
-                            return 0
-                        },
-                        putch: (value) => {
-                            result.textContent += String.fromCharCode(value)
-                            return 0
+                        write: (pointer, length) => {
+                            const bytes = new Uint8Array(memory.buffer, pointer, length)
+                            for (let i = 0; i < length; i += 1024) {
+                                result.textContent += String.fromCharCode(...bytes.subarray(i, i + 1024))
+                            }
                         }
                     }
                 };
 
                 const module = await WebAssembly.instantiate(wasm_binary, imports)
+                memory = module.instance.exports.memory
 
                 result.textContent = `// Compilation successful ${counter++}\n`
 
                 const main_function = module.instance.exports.main;
-                main_function()
+                try {
+                    main_function()
+                } finally {
+                    module.instance.exports.flush() // what was printed before a trap
+                }
             } catch (error) {
                 result.textContent = 'error: ' + error.message;
                 result.className = 'output error';
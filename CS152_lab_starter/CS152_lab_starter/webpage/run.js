@@ -0,0 +1,43 @@
+// runs a page the compiler printed (or a .wat file) under node, with the imports the page gives it
+//     node webpage/run.js index.html [--time] [--count]
+// --time reports how long main ran on stderr, leaving out node's start up and wabt's parse. --count
+// reports the instructions it ran, for a module --quality counted them in with an exported executed
+const fs = require('fs')
+const path = require('path')
+const WabtModule = require(path.join(__dirname, 'wabt.js'))
+
+let wasm_text = fs.readFileSync(process.argv[2], 'latin1')
+const page = wasm_text.match(/<textarea[^>]*>([\s\S]*)<\/textarea>/)
+if (page) { wasm_text = page[1] }
+
+WabtModule().then(async wabt => {
+    const wasm_module = wabt.parseWat('source_code.wat', wasm_text)
+    const wasm_binary = wasm_module.toBinary({}).buffer
+
+    let output = []
+    let memory = null
+    const imports = {
+        env: {
+            write: (pointer, length) => {
+                output.push(Buffer.from(memory.buffer, pointer, length).toString('latin1'))
+            }
+        }
+    }
+
+    const module = await WebAssembly.instantiate(wasm_binary, imports)
+    memory = module.instance.exports.memory
+    const start = process.hrtime.bigint()
+    try {
+        module.instance.exports.main()
+    } finally {
+        module.instance.exports.flush()
+        const elapsed = process.hrtime.bigint() - start
+        process.stdout.write(output.join(''), 'latin1')
+        if (process.argv.includes('--time')) {
+            console.error(`main ran for ${Number(elapsed) / 1e6} ms`)
+        }
+        if (process.argv.includes('--count')) {
+            console.error(`executed ${module.instance.exports.executed()} instructions`)
+        }
+    }
+})